@@ -3,7 +3,7 @@
 
 //==============================================================================
 PunkKompEditor::PunkKompEditor (PunkKompProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), grHistory (p.getLevelHistory()), audioProcessor (p)
 {
     juce::ignoreUnused(audioProcessor);
     
@@ -19,18 +19,28 @@ PunkKompEditor::PunkKompEditor (PunkKompProcessor& p)
     setToggleComponent(onToggle, onToggleAttachment, "ONOFF");
 
     // ================= ASSETS =======================
-    background = juce::ImageCache::getFromMemory(BinaryData::background_png, BinaryData::background_pngSize);
-    lightOff = juce::ImageCache::getFromMemory(BinaryData::lightOff_png, BinaryData::lightOff_pngSize);
-    switchTop = juce::ImageCache::getFromMemory(BinaryData::switchTop_png, BinaryData::switchTop_pngSize);
-    knobImage = juce::ImageCache::getFromMemory(BinaryData::knob_png, BinaryData::knob_pngSize);
+    background.setSource(BinaryData::background_png, BinaryData::background_pngSize);
+    lightOff.setSource(BinaryData::lightOff_png, BinaryData::lightOff_pngSize);
+    switchTop.setSource(BinaryData::switchTop_png, BinaryData::switchTop_pngSize);
     
     // =========== GAIN REDUCTION METER ====================
     addAndMakeVisible(grMeter);
+    addChildComponent(grHistory);
+    
+    // Clicking the meter swaps between the current value and the scrolling history
+    grMeter.onClick = [this] { showHistory(true); };
+    grHistory.onClick = [this] { showHistory(false); };
+    
     startTimerHz(20);
     
+    // =========== RESIZING ====================
+    setResizable(true, true);
+    setResizeLimits(baseWidth, baseHeight, baseWidth * 4, baseHeight * 4);
+    getConstrainer()->setFixedAspectRatio(static_cast<double>(baseWidth) / baseHeight);
+    
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (180, 320);
+    setSize (baseWidth, baseHeight);
 }
 
 PunkKompEditor::~PunkKompEditor()
@@ -41,31 +51,39 @@ void PunkKompEditor::timerCallback()
 {
     grMeter.setLevel(audioProcessor.getGRValue());
     grMeter.repaint();
+    
+    grHistory.setFrameRate(audioProcessor.getHistoryFrameRate());
+    grHistory.update();
+}
+
+void PunkKompEditor::showHistory(bool shouldShowHistory)
+{
+    grMeter.setVisible(!shouldShowHistory);
+    grHistory.setVisible(shouldShowHistory);
 }
 
 //==============================================================================
 void PunkKompEditor::paint (juce::Graphics& g)
 {
-    g.drawImageWithin(background, 0, 0, getWidth(), getHeight(), juce::RectanglePlacement::stretchToFit);
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    background.draw(g, getLocalBounds().toFloat());
         
     // =========== On/Off state ====================
     if (!onToggle.getToggleState()) {
-        juce::AffineTransform t;
-        t = t.scaled(0.485f);
-        t = t.translated(75.5, 144.5);
-        g.drawImageTransformed(lightOff, t);
+        lightOff.draw(g, imageArea(lightOff.getSource(), 0.485f, 75.5f, 144.5f));
     }
     
     // =========== Switch state ====================
     switch((int) voiceSwitch.getValue()){
         case 0:
-            g.drawImageTransformed(switchTop, imageTransforms(0.5f, 72, 14));
+            switchTop.draw(g, imageArea(switchTop.getSource(), 0.5f, 72, 14));
             break;
         case 1:
-            g.drawImageTransformed(switchTop, imageTransforms(0.5f, 82, 14));
+            switchTop.draw(g, imageArea(switchTop.getSource(), 0.5f, 82, 14));
             break;
         case 2:
-            g.drawImageTransformed(switchTop, imageTransforms(0.5f, 92, 14));
+            switchTop.draw(g, imageArea(switchTop.getSource(), 0.5f, 92, 14));
             break;
             
         default:
@@ -90,28 +108,46 @@ void PunkKompEditor::paint (juce::Graphics& g)
     float mixRadians = ((mixKnob.getValue() - 10.0f) / (90.0f) * 300.0f - 150.0f) * DEG2RADS;
     
     // ========== Draw parameter knobs ==================
-    g.drawImageTransformed(knobImage, knobRotation(compRadians, 23.5, 23));
-    g.drawImageTransformed(knobImage, knobRotation(levelRadians, 112.5, 23));
-    g.drawImageTransformed(knobImage, knobRotation(attackRadians, 23.5, 91));
-    g.drawImageTransformed(knobImage, knobRotation(mixRadians, 112.5, 91));
+    knob.draw(g, knobArea(23.5f, 23), compRadians);
+    knob.draw(g, knobArea(112.5f, 23), levelRadians);
+    knob.draw(g, knobArea(23.5f, 91), attackRadians);
+    knob.draw(g, knobArea(112.5f, 91), mixRadians);
+    
+    measurePaint(startTicks);
 }
 
 void PunkKompEditor::resized()
 {
     // Upper row
-    voiceSwitch.setBounds(74, 16, 32, 14);
-    compKnob.setBounds(24, 23, 46, 46);
-    levelKnob.setBounds(113, 23, 46, 46);
+    voiceSwitch.setBounds(scaledArea(74, 16, 32, 14).toNearestInt());
+    compKnob.setBounds(scaledArea(24, 23, 46, 46).toNearestInt());
+    levelKnob.setBounds(scaledArea(113, 23, 46, 46).toNearestInt());
     
     // Bottom row
-    attackKnob.setBounds(24, 91, 46, 46);
-    mixKnob.setBounds(113, 91, 46, 46);
+    attackKnob.setBounds(scaledArea(24, 91, 46, 46).toNearestInt());
+    mixKnob.setBounds(scaledArea(113, 91, 46, 46).toNearestInt());
     
     // Gain reduction meter
-    grMeter.setBounds(3, 177, 173, 16);
+    grMeter.setBounds(scaledArea(3, 177, 173, 16).toNearestInt());
+    grHistory.setBounds(grMeter.getBounds());
     
     // OnOff
-    onToggle.setBounds(65, 240, 50, 50);
+    onToggle.setBounds(scaledArea(65, 240, 50, 50).toNearestInt());
+}
+
+void PunkKompEditor::measurePaint(juce::int64 startTicks)
+{
+    const auto elapsedMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    
+    paintStats.lastMs = elapsedMs;
+    paintStats.maxMs = juce::jmax(paintStats.maxMs, elapsedMs);
+    paintStats.averageMs += (elapsedMs - paintStats.averageMs) / ++paintStats.numFrames;
+    
+    if (elapsedMs > paintBudgetMs)
+        ++paintStats.numOverBudget;
+    
+    if (onPaintMeasured != nullptr)
+        onPaintMeasured(elapsedMs);
 }
 
 void PunkKompEditor::setSliderComponent(juce::Slider &slider, std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> &sliderAttachment, juce::String paramName, juce::String style){
@@ -134,17 +170,24 @@ void PunkKompEditor::setToggleComponent(juce::ToggleButton& button, std::unique_
     button.setAlpha(0);
 }
 
-juce::AffineTransform PunkKompEditor::knobRotation(float radians, float posX, float posY){
-    juce::AffineTransform t;
-    t = t.rotated(radians, 46.0f, 46.0f);
-    t = t.scaled(0.48f);
-    t = t.translated(posX, posY);
-    return t;
+float PunkKompEditor::getScale() const
+{
+    return static_cast<float>(getWidth()) / baseWidth;
 }
 
-juce::AffineTransform PunkKompEditor::imageTransforms(float scaleFactor, float posX, float posY) {
-    juce::AffineTransform t;
-    t = t.scaled(scaleFactor);
-    t = t.translated(posX, posY);
-    return t;
+juce::Rectangle<float> PunkKompEditor::scaledArea(float posX, float posY, float width, float height) const
+{
+    const auto scale = getScale();
+    return { posX * scale, posY * scale, width * scale, height * scale };
+}
+
+juce::Rectangle<float> PunkKompEditor::knobArea(float posX, float posY) const
+{
+    // Same footprint as the old 92px knob artwork drawn at 0.48
+    return scaledArea(posX, posY, 92.0f * 0.48f, 92.0f * 0.48f);
+}
+
+juce::Rectangle<float> PunkKompEditor::imageArea(const juce::Image& image, float scaleFactor, float posX, float posY) const
+{
+    return scaledArea(posX, posY, image.getWidth() * scaleFactor, image.getHeight() * scaleFactor);
 }
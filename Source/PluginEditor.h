@@ -3,6 +3,9 @@
 #include "PluginProcessor.h"
 #include "BinaryData.h"
 #include "GainReductionMeter.h"
+#include "GainReductionHistory.h"
+#include "KnobRenderer.h"
+#include "ScaledImage.h"
 
 #define DEG2RADS 0.0174533f
 
@@ -22,13 +25,42 @@ public:
     //=================== PARAMETER MANIPULATION ===================================
     void setSliderComponent(juce::Slider& slider, std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>& sliderAttachment, juce::String paramName, juce::String style);
     void setToggleComponent(juce::ToggleButton& button, std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment>& buttonAttachment, juce::String paramName);
-    juce::AffineTransform knobRotation(float radians, float posX, float posY);
-    juce::AffineTransform imageTransforms(float scaleFactor, float posX, float posY);
+    
+    //=================== LAYOUT ===================================================
+    // Everything is laid out in the coordinates of the original 180x320 editor
+    // and scaled by the current editor width
+    static constexpr int baseWidth = 180;
+    static constexpr int baseHeight = 320;
+    
+    float getScale() const;
+    juce::Rectangle<float> scaledArea(float posX, float posY, float width, float height) const;
+    juce::Rectangle<float> knobArea(float posX, float posY) const;
+    juce::Rectangle<float> imageArea(const juce::Image& image, float scaleFactor, float posX, float posY) const;
+    
+    //=================== PAINT MEASUREMENT ========================================
+    struct PaintStats
+    {
+        double lastMs = 0.0;
+        double maxMs = 0.0;
+        double averageMs = 0.0;
+        int numFrames = 0;
+        int numOverBudget = 0;
+    };
+    
+    static constexpr double paintBudgetMs = 2.0;
+    const PaintStats& getPaintStats() const { return paintStats; }
+    
+    // Called after every paint() with the time it took, in milliseconds
+    std::function<void(double)> onPaintMeasured;
     
     //=================== GAIN REDUCTION UPDATER ===================================
     void timerCallback() override;
+    void showHistory(bool shouldShowHistory);
 
 private:
+    void measurePaint(juce::int64 startTicks);
+    
+
     // Parameters
     juce::Slider compKnob;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> compKnobAttachment;
@@ -48,14 +80,17 @@ private:
     juce::ToggleButton onToggle;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> onToggleAttachment;
     
-    // Assets - Background, knobs and switch
-    juce::Image background;
-    juce::Image lightOff;
-    juce::Image switchTop;
-    juce::Image knobImage;
+    // Assets - Background, knobs and switch, resampled only when the editor size changes
+    juce::Gui::ScaledImage background;
+    juce::Gui::ScaledImage lightOff;
+    juce::Gui::ScaledImage switchTop;
+    juce::Gui::KnobRenderer knob;
+    
+    PaintStats paintStats;
     
     // Extra
     juce::Gui::GainReductionMeter grMeter;
+    juce::Gui::GainReductionHistory grHistory;
     
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
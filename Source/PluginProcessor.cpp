@@ -14,10 +14,13 @@ PunkKompProcessor::PunkKompProcessor()
                        ), state(*this, nullptr, "parameters", createParams())
 #endif
 {
+    startTimerHz(latencyModePollHz);
 }
 
 PunkKompProcessor::~PunkKompProcessor()
 {
+    // Offline renderers delete instances on their own threads
+    stopTimer();
 }
 
 //==============================================================================
@@ -97,6 +100,28 @@ juce::AudioProcessorValueTreeState::ParameterLayout PunkKompProcessor::createPar
     params.push_back(std::make_unique<juce::AudioParameterFloat>("MIX", "Mix", juce::NormalisableRange<float>(10.0f, 100.0f, 0.1f), DEFAULT_MIX, "%"));
     
     params.push_back(std::make_unique<juce::AudioParameterInt>("VOICE", "Voice", 0, 2, DEFAULT_VOICE));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("LINK", "Linked Detector", false));
+    
+    // Continuous voice instead of the switch, from the left voice (0) through the middle one to the right one (2)
+    params.push_back(std::make_unique<juce::AudioParameterBool>("VMODE", "Voice Morph", false));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("MORPH", "Voice Position", juce::NormalisableRange<float>(0.0f, VoiceMorphTable::maxPosition), DEFAULT_MORPH, ""));
+    
+    // The VOICE's filter curve in linear phase, ahead of the morph. Adds latency.
+    params.push_back(std::make_unique<juce::AudioParameterBool>("LINEAR", "Linear Phase Voice", false));
+    
+    // Multiband mode, the offsets move each band's compression like the COMP knob does
+    params.push_back(std::make_unique<juce::AudioParameterInt>("BANDS", "Bands", 1, 3, DEFAULT_BANDS));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("XLOW", "Low Crossover", juce::NormalisableRange<float>(40.0f, 800.0f, 1.0f, 0.5f), DEFAULT_XLOW, "Hz"));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("XHIGH", "High Crossover", juce::NormalisableRange<float>(1000.0f, 8000.0f, 1.0f, 0.5f), DEFAULT_XHIGH, "Hz"));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("COMPLOW", "Low Band Compression", juce::NormalisableRange<float>(-5.0f, 5.0f, 0.1f), 0.0f, ""));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("COMPMID", "Mid Band Compression", juce::NormalisableRange<float>(-5.0f, 5.0f, 0.1f), 0.0f, ""));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("COMPHIGH", "High Band Compression", juce::NormalisableRange<float>(-5.0f, 5.0f, 0.1f), 0.0f, ""));
+    
+    // Gate threshold on the input level, before COMP's gain. All the way down is off.
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("GATE", "Gate", juce::NormalisableRange<float>(KompParameters::gateOffDecibels, -20.0f, 0.1f), DEFAULT_GATE, "dB"));
+    
+    // Brickwall limiter at the very end, it adds its lookahead to the latency while it's on
+    params.push_back(std::make_unique<juce::AudioParameterBool>("LIMIT", "Safety Limiter", false));
     
     return { params.begin(), params.end() };
 }
@@ -104,7 +129,81 @@ juce::AudioProcessorValueTreeState::ParameterLayout PunkKompProcessor::createPar
 // ============ VALUE GETTERS ======================
 float PunkKompProcessor::getGRValue()
 {
-    return gainReduction.getCurrentValue();
+    // Called from the editor, so it reads the copy published by updateMeter
+    return gainReductionDb.load(std::memory_order_relaxed);
+}
+
+// ============ SUB-BLOCKS ==========================
+template <typename Callback>
+void PunkKompProcessor::forEachSubBlock(int numSamples, Callback&& callback) const
+{
+    // Splits the block on a fixed grid of subBlockSize samples that carries over between blocks,
+    // so everything done per sub-block happens on the same samples whatever the host block size
+    int start = 0;
+    int length = juce::jmin(numSamples, subBlockSize - subBlockFill);
+    
+    while (length > 0)
+    {
+        callback(start, length);
+        start += length;
+        length = juce::jmin(numSamples - start, subBlockSize);
+    }
+}
+
+void PunkKompProcessor::addSubBlockSegment(float inputPeak, float outputPeak, int numSamples)
+{
+    addHistorySegment(inputPeak, outputPeak, numSamples);
+    
+    subBlockInput = juce::jmax(subBlockInput, inputPeak);
+    subBlockOutput = juce::jmax(subBlockOutput, outputPeak);
+    subBlockFill += numSamples;
+    
+    if (subBlockFill == subBlockSize)
+    {
+        updateMeter();
+        
+        subBlockInput = subBlockOutput = 0.0f;
+        subBlockFill = 0;
+    }
+}
+
+void PunkKompProcessor::updateMeter()
+{
+    // Gain reduction meter: jumps up, falls back over gainReduction's ramp
+    gainReduction.skip(subBlockSize);
+    
+    if (! on)
+    {
+        gainReduction.setCurrentAndTargetValue(0.0f);
+    }
+    else
+    {
+        const auto value = juce::Decibels::gainToDecibels(subBlockInput) - juce::Decibels::gainToDecibels(subBlockOutput);
+        if (value < gainReduction.getCurrentValue())
+            gainReduction.setTargetValue(value);
+        else
+            gainReduction.setCurrentAndTargetValue(value);
+    }
+    
+    gainReductionDb.store(gainReduction.getCurrentValue(), std::memory_order_relaxed);
+}
+
+// ============ GAIN REDUCTION HISTORY ==============
+
+void PunkKompProcessor::addHistorySegment(float inputPeak, float outputPeak, int numSamples)
+{
+    historyFrameInput = juce::jmax(historyFrameInput, inputPeak);
+    historyFrameOutput = juce::jmax(historyFrameOutput, outputPeak);
+    historyFrameFill += numSamples;
+    
+    if (historyFrameFill == LevelHistory::samplesPerFrame)
+    {
+        const float inputDb = juce::Decibels::gainToDecibels(historyFrameInput);
+        levelHistory.push({ inputDb, inputDb - juce::Decibels::gainToDecibels(historyFrameOutput) });
+        
+        historyFrameInput = historyFrameOutput = 0.0f;
+        historyFrameFill = 0;
+    }
 }
 
 // ============ VALUE UPDATERS =====================
@@ -118,94 +217,199 @@ void PunkKompProcessor::updateOutput()
 {
     auto OUT = state.getRawParameterValue("LEVEL");
     float val = OUT->load();
-    outputLevel.setGainDecibels(val);
+    engine.setOutputGainDecibels(val);
 }
 
 void PunkKompProcessor::updateComp()
 {
     auto THRES = state.getRawParameterValue("COMP");
     
-    threshold = juce::jmap(THRES->load(), 0.f, 10.f, -5.f, -25.f);
-    float inputGain = juce::jmap(THRES->load(), 0.f, 10.f, -5.f, 20.f);
+    threshold = KompParameters::getThresholdDecibels(THRES->load());
+    float inputGain = KompParameters::getInputGainDecibels(THRES->load());
     
-    inputLevel.setGainDecibels(inputGain);
-    comp.setThreshold(threshold);
+    engine.setInputGainDecibels(inputGain);
+    engine.setThreshold(threshold);
+}
+
+void PunkKompProcessor::updateGate()
+{
+    auto GATE = state.getRawParameterValue("GATE");
+    KompParameters::setGate(engine, GATE->load());
 }
 
 void PunkKompProcessor::updateAttack()
 {
     auto ATT = state.getRawParameterValue("ATTACK");
     attackTime = ATT->load();
-    comp.setAttack(attackTime);
+    engine.setAttack(attackTime);
 }
 
 void PunkKompProcessor::updateMix()
 {
     auto MIX = state.getRawParameterValue("MIX");
-    dryWetMix.setWetMixProportion(MIX->load() / 100.0f);
+    engine.setMix(KompParameters::getWetProportion(MIX->load()));
 }
 
 void PunkKompProcessor::updateVoice()
 {
     auto VOICE = state.getRawParameterValue("VOICE");
+    auto VMODE = state.getRawParameterValue("VMODE");
+    auto MORPH = state.getRawParameterValue("MORPH");
+    auto LINEAR = state.getRawParameterValue("LINEAR");
     voice = VOICE->load();
     
-    float sampleRate = getSampleRate();
-    
-    switch (voice) {
-        case 0:
-            *voiceEq.get<0>().state = *juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2430.f, 0.5f, 2.0f);
-            break;
-        case 1:
-            *voiceEq.get<0>().state = *juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2430.f, 0.5f, 1.f);
-            break;
-        case 2:
-            *voiceEq.get<0>().state = *juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2000.f, 0.35f, 2.5f);
-            break;
-            
-        default:
-            break;
-    };
+    // The morph ramps on its own, the switch's voice is kept for when it's off
+    engine.setVoiceMorphEnabled(VMODE->load() > 0.5f);
+    engine.setVoiceMorphPosition(MORPH->load());
+    
+    // The linear phase voice moves the latency, so the message thread switches it and reports the
+    // latency (timerCallback). Offline renders switch it here, on the block it changes, so they come
+    // out the same every time. It was built for them before they started (setNonRealtime).
+    if (isNonRealtime())
+        engine.setLinearPhaseVoiceEnabled(LINEAR->load() > 0.5f);
+    
+    // Coefficients are only swapped when the voice actually changes
+    if (voice == currentVoice || voiceCoefficients == nullptr)
+        return;
+    
+    if (voice >= 0 && voice < VoiceCoefficients::numVoices)
+    {
+        currentVoice = voice;
+        engine.setPeakCoefficients(voiceCoefficients->peak[(size_t) voice]);
+        engine.setLinearPhaseVoice(voice);
+    }
+}
+
+void PunkKompProcessor::updateLatencyModes()
+{
+    // Its buffers are only made once it's wanted. The filter voice plays until they're ready.
+    const bool linear = state.getRawParameterValue("LINEAR")->load() > 0.5f;
+    
+    if (linear)
+        engine.prepareLinearPhaseVoice();
+    
+    engine.setLinearPhaseVoiceEnabled(linear);
+    engine.setLimiterEnabled(state.getRawParameterValue("LIMIT")->load() > 0.5f);
+}
+
+void PunkKompProcessor::timerCallback()
+{
+    // Not prepared yet, there's nothing to build or report
+    if (voiceCoefficients == nullptr)
+        return;
+    
+    if (! isNonRealtime())
+        updateLatencyModes();
+    
+    updateLatency();
+}
+
+void PunkKompProcessor::setNonRealtime(bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(isNonRealtime);
+    
+    // Offline renders switch the linear phase voice on the audio thread, so it's there before they start
+    if (isNonRealtime && voiceCoefficients != nullptr)
+        engine.prepareLinearPhaseVoice();
+}
+
+void PunkKompProcessor::updateLink()
+{
+    auto LINK = state.getRawParameterValue("LINK");
+    linked = LINK->load() > 0.5f;
+    engine.setLinked(linked);
+}
+
+void PunkKompProcessor::updateBands()
+{
+    auto BANDS = state.getRawParameterValue("BANDS");
+    auto XLOW = state.getRawParameterValue("XLOW");
+    auto XHIGH = state.getRawParameterValue("XHIGH");
+    
+    const int numBands = (int) BANDS->load();
+    engine.setNumBands(numBands);
+    engine.setCrossoverFrequencies(XLOW->load(), XHIGH->load());
+    
+    const char* offsetIDs[] = { "COMPLOW", "COMPMID", "COMPHIGH" };
+    
+    for (int band = 0; band < KompEngine::maxBands; ++band)
+    {
+        const float offset = state.getRawParameterValue(offsetIDs[KompParameters::getBandOffsetIndex(numBands, band)])->load();
+        KompParameters::setBandOffset(engine, band, offset);
+    }
+}
+
+void PunkKompProcessor::updateLimit()
+{
+    // Like the linear phase voice, it moves the latency: timerCallback switches it, offline renders switch it here
+    auto LIMIT = state.getRawParameterValue("LIMIT");
+    
+    if (isNonRealtime())
+        engine.setLimiterEnabled(LIMIT->load() > 0.5f);
+}
+
+void PunkKompProcessor::updateLatency()
+{
+    // The linear phase voice and the limiter add to it. Hosts pick the new latency up
+    // asynchronously, and the engine crossfades to it meanwhile
+    if (getLatencySamples() != engine.getLatencySamples())
+        setLatencySamples(engine.getLatencySamples());
 }
 
 void PunkKompProcessor::updateState()
 {
     updateOnOff();
     updateComp();
+    updateGate();
     updateAttack();
     updateMix();
     updateVoice();
+    updateLink();
+    updateBands();
     updateOutput();
+    updateLimit();
 }
 
 //==============================================================================
 void PunkKompProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    juce::ignoreUnused(samplesPerBlock);
+    
+    // The engine only ever sees one sub-block at a time
     juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
+    spec.maximumBlockSize = subBlockSize;
     spec.numChannels = getTotalNumOutputChannels();
     spec.sampleRate = sampleRate;
     
-    inputLevel.prepare(spec);
-    inputLevel.setRampDurationSeconds(0.1f);
+    engine.prepare(spec);
     
-    comp.prepare(spec);
-    comp.setRatio(compressionRatio);
-    comp.setThreshold(threshold);
-    comp.setAttack(attackTime);
-    comp.setRelease(releaseTime);
+    voiceCoefficients = &dspResources->getVoiceCoefficients(sampleRate);
+    KompParameters::setFixedParameters(engine, *voiceCoefficients, dspResources->getVoiceMorph(sampleRate));
     
-    dryWetMix.prepare(spec);
+    // If it's already on it's made here, so playback starts with it rather than waiting for the message thread.
+    // Offline renders have it either way, as they switch it on the audio thread.
+    if (isNonRealtime())
+        engine.prepareLinearPhaseVoice();
     
-    voiceEq.prepare(spec);
-    voiceEq.reset();
-    *voiceEq.get<1>().state = *juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 10.f);
+    updateLatencyModes();
     
-    outputLevel.prepare(spec);
-    outputLevel.setRampDurationSeconds(0.1f);
+    // Start from the current parameter values instead of ramping to them
+    currentVoice = -1;
+    updateState();
+    engine.reset();
+    
+    // Hosts read the latency as prepareToPlay returns
+    updateLatency();
     
     gainReduction.reset(sampleRate, 0.5);
     gainReduction.setCurrentAndTargetValue(0.0f);
+    gainReductionDb.store(0.0f, std::memory_order_relaxed);
+    
+    historyFrameFill = 0;
+    historyFrameInput = historyFrameOutput = 0.0f;
+    
+    subBlockFill = 0;
+    subBlockInput = subBlockOutput = 0.0f;
 }
 
 void PunkKompProcessor::releaseResources()
@@ -221,12 +425,10 @@ bool PunkKompProcessor::isBusesLayoutSupported (const BusesLayout& layouts) cons
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout from mono up to 16 discrete channels (5.1, 7.1.4...)
+    const auto numChannels = layouts.getMainOutputChannelSet().size();
+    
+    if (numChannels < 1 || numChannels > KompEngine::maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -257,42 +459,27 @@ void PunkKompProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Mi
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    updateState();
-    if(on)
-    {
-        juce::dsp::AudioBlock<float> audioBlock = juce::dsp::AudioBlock<float>(buffer);
-        dryWetMix.pushDrySamples(audioBlock);
-        
-        // Input
-        inputLevel.process(juce::dsp::ProcessContextReplacing<float>(audioBlock));
-        float peakInput = juce::Decibels::gainToDecibels(buffer.getMagnitude(0, buffer.getNumSamples()));
-        
-        // Compressor
-        comp.process(juce::dsp::ProcessContextReplacing<float>(audioBlock));
-        
-        float peakOutput = juce::Decibels::gainToDecibels(buffer.getMagnitude(0, buffer.getNumSamples()));
+    juce::dsp::AudioBlock<float> audioBlock = juce::dsp::AudioBlock<float>(buffer).getSubsetChannelBlock(0, (size_t) totalNumOutputChannels);
+    
+    forEachSubBlock(buffer.getNumSamples(), [&](int start, int length) {
+        // Parameters are picked up at the start of each sub-block
+        if (subBlockFill == 0)
+            updateState();
         
-        // Gain reduction meter
-        gainReduction.skip(buffer.getNumSamples());
+        if(on)
+        {
+            // Input gain, compressor, mix, voice and output gain
+            const auto levels = engine.process(audioBlock.getSubBlock((size_t) start, (size_t) length));
+            addSubBlockSegment(levels.input, levels.compressed, length);
+        } else
         {
-            const auto value = peakInput - peakOutput;
-            if (value < gainReduction.getCurrentValue())
-                gainReduction.setTargetValue(value);
-            else
-                gainReduction.setCurrentAndTargetValue(value);
+            const auto peak = buffer.getMagnitude(start, length);
+            addSubBlockSegment(peak, peak, length);
+            
+            // Keeps the limiter's and the linear phase voice's latency, if they're on
+            engine.processBypassed(audioBlock.getSubBlock((size_t) start, (size_t) length));
         }
-        
-        // Mix
-        dryWetMix.mixWetSamples(audioBlock);
-        
-        // Voice
-        voiceEq.process(juce::dsp::ProcessContextReplacing<float>(audioBlock));
-        
-        // Output
-        outputLevel.process(juce::dsp::ProcessContextReplacing<float>(audioBlock));
-        
-    } else
-        gainReduction.setCurrentAndTargetValue(0.0f);
+    });
 }
 
 //==============================================================================
@@ -309,19 +496,17 @@ juce::AudioProcessorEditor* PunkKompProcessor::createEditor()
 //==============================================================================
 void PunkKompProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    
-    juce::ignoreUnused(destData);
+    // copyState and replaceState lock the tree, and the audio thread only ever sees
+    // the parameters' atomics, so hosts may call these from any thread
+    if (auto xml = state.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
 }
 
 void PunkKompProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    
-    juce::ignoreUnused(data, sizeInBytes);
+    if (auto xml = getXmlFromBinary(data, sizeInBytes))
+        if (xml->hasTagName(state.state.getType()))
+            state.replaceState(juce::ValueTree::fromXml(*xml));
 }
 
 //==============================================================================
@@ -3,21 +3,22 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
+#include "DspResources.h"
+#include "ImageResources.h"
+#include "KompEngine.h"
+#include "KompParameters.h"
+#include "LevelHistory.h"
+
 #if (MSVC)
 #include "ipps.h"
 #endif
 
-#define DEFAULT_OUTPUT 0.0f
-#define DEFAULT_COMP 5.0f
-#define DEFAULT_ATTACK 30.0f
-#define DEFAULT_MIX 80.0f
-#define DEFAULT_VOICE 1
-
 //==============================================================================
 /**
 */
 
-class PunkKompProcessor  : public juce::AudioProcessor
+class PunkKompProcessor  : public juce::AudioProcessor,
+                           private juce::Timer
 {
 public:
     //==============================================================================
@@ -27,6 +28,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -62,42 +64,81 @@ public:
     
     // Getters
     float getGRValue();
+    const LevelHistory& getLevelHistory() const { return levelHistory; }
+    double getHistoryFrameRate() const { return getSampleRate() / LevelHistory::samplesPerFrame; }
     
     // Updaters
     void updateOnOff();
     void updateOutput();
     void updateComp();
+    void updateGate();
     void updateAttack();
     void updateMix();
     void updateVoice();
+    void updateLink();
+    void updateBands();
+    void updateLimit();
+    void updateLatency();
     void updateState();
     
     void process(float* samples, int numSamples);
+    
+    // Control rate work (parameters, meter, history) runs on fixed sub-blocks of this many samples
+    static constexpr int subBlockSize = 32;
+    
+    // History
+    void addHistorySegment(float inputPeak, float outputPeak, int numSamples);
 
 private:
     juce::AudioProcessorValueTreeState::ParameterLayout createParams();
-    using FilterBand = juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>>;
-    using Gain = juce::dsp::Gain<float>;
-    using Compressor = juce::dsp::Compressor<float>;
-    using Mix = juce::dsp::DryWetMixer<float>;
     
-    juce::dsp::ProcessorChain<FilterBand, FilterBand> voiceEq;
+    // Switches what moves the latency (the linear phase voice, which it builds, and the limiter),
+    // and reports the latency, on the message thread. The audio thread never signals it: the timer
+    // polls the parameters.
+    void updateLatencyModes();
+    void timerCallback() override;
+    static constexpr int latencyModePollHz = 20;
+    
+    // Input gain, compressor, mix, voice EQ and output gain, for up to 16 channels
+    KompEngine engine;
+    
+    // Voice coefficients shared with the other instances, looked up for the sample rate in prepareToPlay
+    juce::SharedResourcePointer<DspResources> dspResources;
+    const VoiceCoefficients* voiceCoefficients = nullptr;
     
-    // Modifiable parameters
+    // Keeps the editors' decoded images alive between editors: without it, closing the last
+    // editor of the session drops them, and the next one to open decodes everything again
+    juce::SharedResourcePointer<juce::Gui::ImageResources> editorImages;
+    
+    // Modifiable parameters, only touched on the audio thread (by updateState)
     float threshold;
     float attackTime;
     int voice;
     bool on;
-    Mix dryWetMix;
-    Gain inputLevel, outputLevel;
-    
-    // Hidden compressor parameters
-    Compressor comp;
-    const float compressionRatio = 4.0f;
-    float releaseTime = 50.0f;
+    bool linked;
+    int currentVoice = -1;
     
     // Other stuff
     juce::LinearSmoothedValue<float> gainReduction;
+    std::atomic<float> gainReductionDb { 0.0f }; // what the editor's meter reads
+    
+    // Sub-blocks, carried over between host blocks
+    template <typename Callback>
+    void forEachSubBlock(int numSamples, Callback&& callback) const;
+    void addSubBlockSegment(float inputPeak, float outputPeak, int numSamples);
+    void updateMeter();
+    
+    int subBlockFill = 0;
+    float subBlockInput = 0.0f;
+    float subBlockOutput = 0.0f;
+    
+    // Gain reduction history, one frame every LevelHistory::samplesPerFrame samples
+    static_assert(LevelHistory::samplesPerFrame % subBlockSize == 0, "History frames must be made of whole sub-blocks");
+    
+    LevelHistory levelHistory;
+    int historyFrameFill = 0;
+    float historyFrameInput = 0.0f;
+    float historyFrameOutput = 0.0f;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PunkKompProcessor)
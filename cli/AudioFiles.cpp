@@ -0,0 +1,79 @@
+#include "AudioFiles.h"
+
+namespace PunkKompCLI
+{
+    AudioFile readAudioFile (const juce::File& file)
+    {
+        const auto reader = createAudioFileReader (file);
+
+        AudioFile result;
+        result.sampleRate = reader->sampleRate;
+        result.buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&result.buffer, 0, (int) reader->lengthInSamples, 0, true, true);
+
+        return result;
+    }
+
+    void writeAudioFile (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        createAudioFileWriter (file, sampleRate, buffer.getNumChannels())->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> createAudioFileReader (const juce::File& file)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+
+        if (reader == nullptr)
+            juce::ConsoleApplication::fail ("Couldn't read " + file.getFullPathName());
+
+        return reader;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createAudioFileWriter (const juce::File& file, double sampleRate, int numChannels)
+    {
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+
+        if (stream == nullptr)
+            juce::ConsoleApplication::fail ("Couldn't write " + file.getFullPathName());
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (juce::WavAudioFormat().createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels, 32, {}, 0));
+
+        if (writer == nullptr)
+            juce::ConsoleApplication::fail ("Couldn't write " + file.getFullPathName());
+
+        stream.release(); // the writer owns it now
+        return writer;
+    }
+
+    Difference findLargestDifference (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        Difference result;
+
+        if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+        {
+            result.sameShape = false;
+            return result;
+        }
+
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+        {
+            const auto* x = a.getReadPointer (ch);
+            const auto* y = b.getReadPointer (ch);
+
+            for (int i = 0; i < a.getNumSamples(); ++i)
+            {
+                const auto error = std::abs (x[i] - y[i]);
+
+                // NaN counts as the worst possible difference
+                if (error > result.maxError || error != error)
+                    result = { error != error ? std::numeric_limits<float>::infinity() : error, ch, i, true };
+            }
+        }
+
+        return result;
+    }
+}
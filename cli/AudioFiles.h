@@ -0,0 +1,35 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+namespace PunkKompCLI
+{
+    struct AudioFile
+    {
+        juce::AudioBuffer<float> buffer;
+        double sampleRate = 0.0;
+    };
+
+    /** Reads a whole file, fails the command if it can't. */
+    AudioFile readAudioFile (const juce::File& file);
+
+    /** Writes 32 bit float WAV, so renders can be compared sample by sample. */
+    void writeAudioFile (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    /** The same, a piece at a time: a reader for any of the basic formats, and a writer that
+        replaces the file with 32 bit float WAV. Both fail the command if they can't.
+    */
+    std::unique_ptr<juce::AudioFormatReader> createAudioFileReader (const juce::File& file);
+    std::unique_ptr<juce::AudioFormatWriter> createAudioFileWriter (const juce::File& file, double sampleRate, int numChannels);
+
+    //==============================================================================
+    struct Difference
+    {
+        float maxError = 0.0f;
+        int channel = 0, sample = 0;
+        bool sameShape = true;
+    };
+
+    /** Largest per-sample difference between two buffers of the same shape. */
+    Difference findLargestDifference (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b);
+}
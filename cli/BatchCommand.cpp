@@ -0,0 +1,190 @@
+#include "AudioFiles.h"
+#include "Commands.h"
+#include "KompBatch.h"
+#include "OfflineRenderer.h"
+#include "TestSignals.h"
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+
+        // A different test signal and different settings for every stream, spread over the parameters' ranges
+        juce::AudioBuffer<float> makeInput (int numStreams, double seconds)
+        {
+            const auto names = TestSignals::getNames();
+            juce::AudioBuffer<float> input (numStreams, (int) (seconds * sampleRate));
+
+            for (int stream = 0; stream < numStreams; ++stream)
+            {
+                const auto signal = TestSignals::make (names[stream % names.size()], sampleRate, 1, seconds);
+                input.copyFrom (stream, 0, signal, 0, 0, juce::jmin (input.getNumSamples(), signal.getNumSamples()));
+            }
+
+            return input;
+        }
+
+        void setStreamParameters (OfflineRenderer& renderer, int stream)
+        {
+            renderer.setParameter ("COMP", (float) (stream * 37 % 101) * 0.1f);
+            renderer.setParameter ("ATTACK", 1.0f + (float) (stream * 13 % 100));
+            renderer.setParameter ("MIX", 10.0f + (float) (stream * 7 % 91));
+            renderer.setParameter ("VOICE", (float) (stream % VoiceCoefficients::numVoices));
+            renderer.setParameter ("LEVEL", (float) (stream % 7) * 3.0f - 9.0f);
+        }
+
+        // The values the processor ended up with, snapped to its parameters' steps
+        KompBatch::Parameters getParameters (PunkKompProcessor& processor)
+        {
+            const auto value = [&processor] (const char* id) { return processor.state.getRawParameterValue (id)->load(); };
+
+            KompBatch::Parameters parameters;
+            parameters.comp = value ("COMP");
+            parameters.attackMs = value ("ATTACK");
+            parameters.mix = value ("MIX");
+            parameters.voice = (int) value ("VOICE");
+            parameters.levelDecibels = value ("LEVEL");
+            return parameters;
+        }
+
+        struct Result
+        {
+            double nanoseconds = std::numeric_limits<double>::max();
+            juce::AudioBuffer<float> output;
+        };
+
+        double nanosecondsPerSample (juce::int64 start, const juce::AudioBuffer<float>& buffer)
+        {
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+            return elapsed * 1.0e9 / (buffer.getNumSamples() * buffer.getNumChannels());
+        }
+
+        // One mono processor per stream, each run over its whole stream like a bounce would,
+        // best of the runs in ns per stream sample
+        Result runProcessors (const juce::AudioBuffer<float>& input, std::vector<KompBatch::Parameters>& parameters, int runs)
+        {
+            Result result;
+            parameters.resize ((size_t) input.getNumChannels());
+
+            for (int run = 0; run < runs; ++run)
+            {
+                std::vector<std::unique_ptr<OfflineRenderer>> renderers;
+
+                for (int stream = 0; stream < input.getNumChannels(); ++stream)
+                {
+                    renderers.push_back (std::make_unique<OfflineRenderer> (sampleRate, 1, blockSize));
+                    setStreamParameters (*renderers.back(), stream);
+                    parameters[(size_t) stream] = getParameters (renderers.back()->getProcessor());
+                }
+
+                result.output.makeCopyOf (input);
+                const auto start = juce::Time::getHighResolutionTicks();
+
+                for (int stream = 0; stream < input.getNumChannels(); ++stream)
+                {
+                    juce::AudioBuffer<float> channel (result.output.getArrayOfWritePointers() + stream, 1, result.output.getNumSamples());
+                    renderers[(size_t) stream]->process (channel);
+                }
+
+                result.nanoseconds = juce::jmin (result.nanoseconds, nanosecondsPerSample (start, input));
+            }
+
+            return result;
+        }
+
+        // The same streams through one KompBatch, a block at a time
+        Result runBatch (const KompDispatch::Variant& variant, const juce::AudioBuffer<float>& input,
+                         const std::vector<KompBatch::Parameters>& parameters, int runs)
+        {
+            Result result;
+            KompBatch batch;
+
+            for (int run = 0; run < runs; ++run)
+            {
+                // Parameters set after prepare ramp in from the defaults, as they do in the processors
+                batch.prepare (sampleRate, input.getNumChannels(), variant);
+
+                for (int stream = 0; stream < input.getNumChannels(); ++stream)
+                    batch.setParameters (stream, parameters[(size_t) stream]);
+
+                result.output.makeCopyOf (input);
+                std::vector<float*> streams ((size_t) input.getNumChannels());
+                const auto start = juce::Time::getHighResolutionTicks();
+
+                for (int i = 0; i < input.getNumSamples(); i += blockSize)
+                {
+                    for (int stream = 0; stream < input.getNumChannels(); ++stream)
+                        streams[(size_t) stream] = result.output.getWritePointer (stream, i);
+
+                    batch.process (streams.data(), juce::jmin (blockSize, input.getNumSamples() - i));
+                }
+
+                result.nanoseconds = juce::jmin (result.nanoseconds, nanosecondsPerSample (start, input));
+            }
+
+            return result;
+        }
+
+        void runBatchBench (const juce::ArgumentList& args)
+        {
+            const auto numStreams = juce::jmax (1, (int) getNumberForOption (args, "--streams", 64));
+            const auto seconds = getNumberForOption (args, "--seconds", 2.0);
+            const auto runs = juce::jmax (1, (int) getNumberForOption (args, "--runs", 3));
+
+            const auto input = makeInput (numStreams, seconds);
+
+            std::vector<KompBatch::Parameters> parameters;
+            const auto reference = runProcessors (input, parameters, runs);
+
+            std::cout << numStreams << " mono streams, ns per stream sample, * marks the variant KompBatch picks\n\n"
+                      << juce::String ("processors").paddedRight (' ', 16)
+                      << juce::String (reference.nanoseconds, 2) << std::endl;
+
+            const auto* chosen = &KompDispatch::chooseBatch();
+            auto identical = true;
+
+            for (const auto& variant : KompDispatch::getSupportedVariants())
+            {
+                if (variant.processBatch == nullptr)
+                    continue;
+
+                const auto result = runBatch (variant, input, parameters, runs);
+                const auto difference = findLargestDifference (reference.output, result.output);
+
+                if (difference.maxError != 0.0f)
+                {
+                    identical = false;
+                    std::cout << variant.name << " differs by " << difference.maxError << " on stream " << difference.channel
+                              << " at sample " << difference.sample << std::endl;
+                }
+
+                std::cout << (juce::String (variant.name) + " (" + juce::String (variant.laneWidth) + ")").paddedRight (' ', 16)
+                          << (juce::String (result.nanoseconds, 2) + (&variant == chosen ? "*" : "")).paddedRight (' ', 10)
+                          << juce::String (reference.nanoseconds / result.nanoseconds, 1) << "x" << std::endl;
+            }
+
+            KompBatch batch;
+            batch.prepare (sampleRate, numStreams);
+            std::cout << "\nScratch memory: " << batch.getScratchBytes() << " bytes" << std::endl;
+
+            if (! identical)
+                juce::ConsoleApplication::fail ("The batch doesn't give the same output as the processors");
+        }
+    }
+
+    void addBatchCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "batch",
+                          "batch [--streams=64] [--seconds=2] [--runs=3]",
+                          "Times KompBatch against one processor per stream",
+                          "Renders that many mono streams, each with its own test signal and its own\n"
+                          "COMP, ATTACK, MIX, VOICE and LEVEL, once through a mono PunkKompProcessor\n"
+                          "per stream and once through KompBatch with every kernel variant that can\n"
+                          "run it. Prints the time per stream sample and the speedup over the\n"
+                          "processors, and fails if any variant's output differs from theirs by\n"
+                          "even one bit.",
+                          [] (const juce::ArgumentList& args) { runBatchBench (args); } });
+    }
+}
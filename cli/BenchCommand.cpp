@@ -0,0 +1,172 @@
+#include "AudioFiles.h"
+#include "Commands.h"
+#include "KompEngine.h"
+#include "TestSignals.h"
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 32;   // what the processor hands the engine
+
+        struct Mode
+        {
+            const char* name;
+            bool linked;
+            int numBands;
+            size_t voice;
+            bool linearPhase;
+        };
+
+        // "linear phase" is the compressor's voice in linear phase, against the biquad above it
+        const Mode modes[] = {
+            { "compressor", false, 1, 0, false },
+            { "linear phase", false, 1, 0, true },
+            { "linked", true, 1, 0, false },
+            { "3 bands", false, 3, 0, false },
+            { "flat voice", false, 1, 1, false },
+        };
+
+        struct Result
+        {
+            double nanoseconds = 0.0, worstBlockMicroseconds = 0.0;
+            juce::AudioBuffer<float> output;
+        };
+
+        // Best of a few runs of the engine at the processor's default settings, in ns per channel sample,
+        // and the slowest block, which is what a deadline has to fit (best of the runs too, as a run the
+        // OS interrupted has a slow block of its own)
+        Result run (const KompDispatch::Variant& variant, const Mode& mode, const juce::AudioBuffer<float>& input, int runs)
+        {
+            juce::SharedResourcePointer<DspResources> resources;
+            const auto& voices = resources->getVoiceCoefficients (sampleRate);
+
+            KompEngine engine;
+            engine.prepare ({ sampleRate, (juce::uint32) blockSize, (juce::uint32) input.getNumChannels() });
+            engine.setKernelVariant (variant);
+            engine.setRatio (4.0f);
+            engine.setRelease (50.0f);
+            engine.setAttack (30.0f);
+            engine.setInputGainDecibels (7.5f);
+            engine.setThreshold (-15.0f);
+            engine.setOutputGainDecibels (0.0f);
+            engine.setMix (0.8f);
+            engine.setLinked (mode.linked);
+            engine.setNumBands (mode.numBands);
+            engine.setPeakCoefficients (voices.peak[mode.voice]);
+
+            engine.setLinearPhaseVoice ((int) mode.voice);
+            engine.setLinearPhaseVoiceEnabled (mode.linearPhase);
+
+            if (mode.linearPhase)
+                engine.prepareLinearPhaseVoice();
+
+            engine.setHighPassCoefficients (voices.highPass);
+
+            Result result;
+            result.nanoseconds = result.worstBlockMicroseconds = std::numeric_limits<double>::max();
+
+            juce::ScopedNoDenormals noDenormals;
+
+            for (int run = 0; run < runs; ++run)
+            {
+                result.output.makeCopyOf (input);
+                engine.reset();
+
+                juce::dsp::AudioBlock<float> block (result.output);
+                const auto start = juce::Time::getHighResolutionTicks();
+                juce::int64 worstBlock = 0;
+
+                for (size_t i = 0; i < block.getNumSamples(); i += blockSize)
+                {
+                    const auto blockStart = juce::Time::getHighResolutionTicks();
+                    engine.process (block.getSubBlock (i, juce::jmin ((size_t) blockSize, block.getNumSamples() - i)));
+                    worstBlock = juce::jmax (worstBlock, juce::Time::getHighResolutionTicks() - blockStart);
+                }
+
+                const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+                result.nanoseconds = juce::jmin (result.nanoseconds, elapsed * 1.0e9 / (input.getNumSamples() * input.getNumChannels()));
+                result.worstBlockMicroseconds = juce::jmin (result.worstBlockMicroseconds, juce::Time::highResolutionTicksToSeconds (worstBlock) * 1.0e6);
+            }
+
+            return result;
+        }
+
+        void runBench (const juce::ArgumentList& args)
+        {
+            const auto seconds = getNumberForOption (args, "--seconds", 2.0);
+            const auto runs = juce::jmax (1, (int) getNumberForOption (args, "--runs", 3));
+            auto channelCounts = juce::StringArray::fromTokens (args.getValueForOption ("--channels").trim(), ",", {});
+
+            if (channelCounts.isEmpty())
+                channelCounts = { "1", "2", "6", "8", "12", "16" };
+
+            const auto& variants = KompDispatch::getSupportedVariants();
+            juce::String header = juce::String ("channels").paddedRight (' ', 10) + juce::String ("mode").paddedRight (' ', 14);
+
+            for (const auto& variant : variants)
+                header << (juce::String (variant.name) + " (" + juce::String (variant.laneWidth) + ")").paddedRight (' ', 20);
+
+            std::cout << "ns per channel sample / worst " << blockSize << " sample block in us, * marks the variant the engine picks\n\n" << header << std::endl;
+            auto identical = true;
+
+            for (const auto& count : channelCounts)
+            {
+                const auto numChannels = juce::jlimit (1, KompEngine::maxChannels, count.getIntValue());
+                const auto input = TestSignals::make ("drums", sampleRate, numChannels, seconds);
+                const auto* chosen = &KompDispatch::choose (numChannels);
+
+                for (const auto& mode : modes)
+                {
+                    juce::String line = juce::String (numChannels).paddedRight (' ', 10) + juce::String (mode.name).paddedRight (' ', 14);
+                    juce::AudioBuffer<float> baseline;
+
+                    for (const auto& variant : variants)
+                    {
+                        if (! variant.canProcess (numChannels))
+                        {
+                            line << juce::String ("-").paddedRight (' ', 20);
+                            continue;
+                        }
+
+                        const auto result = run (variant, mode, input, runs);
+
+                        // Every variant has to give the same samples as the baseline
+                        if (baseline.getNumSamples() == 0)
+                            baseline.makeCopyOf (result.output);
+                        else if (findLargestDifference (baseline, result.output).maxError != 0.0f)
+                            identical = false;
+
+                        line << (juce::String (result.nanoseconds, 2) + (&variant == chosen ? "*" : "") + " / " + juce::String (result.worstBlockMicroseconds, 1)).paddedRight (' ', 20);
+                    }
+
+                    std::cout << line << std::endl;
+                }
+            }
+
+            // Same for every layout, the engine sizes its scratch for all the channels it accepts
+            KompEngine engine;
+            engine.prepare ({ sampleRate, (juce::uint32) blockSize, 2 });
+            std::cout << "\nScratch memory per engine: " << engine.getScratchBytes() << " bytes" << std::endl;
+
+            if (! identical)
+                juce::ConsoleApplication::fail ("The kernel variants don't give identical output");
+        }
+    }
+
+    void addBenchCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "bench",
+                          "bench [--channels=1,2,6,8,12,16] [--seconds=2] [--runs=3]",
+                          "Times the DSP kernel variants this CPU supports",
+                          "Runs the engine with every kernel variant (baseline, mono, stereo, AVX2,\n"
+                          "AVX-512) that can take the channel count, in each detector mode, with the\n"
+                          "linear phase voice (FFT overlap-save) and the flat voice, and prints the\n"
+                          "time per channel sample and the slowest block (what has to fit the audio\n"
+                          "callback's deadline), marking the variant prepare() picks. Fails if a\n"
+                          "variant's output differs from the baseline's by even one bit. Also prints\n"
+                          "the engine's scratch memory.",
+                          [] (const juce::ArgumentList& args) { runBench (args); } });
+    }
+}
@@ -0,0 +1,157 @@
+#include "AudioFiles.h"
+#include "Commands.h"
+#include "OfflineRenderer.h"
+#include "TestSignals.h"
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numChannels = 2;
+        constexpr double seconds = 1.0;
+
+        // The processor's own grid is the reference, the others are odd sizes, sizes smaller
+        // and larger than a sub-block, and the large buffers an offline bounce uses
+        constexpr int referenceBlockSize = PunkKompProcessor::subBlockSize;
+        constexpr int otherBlockSizes[] = { 1, 7, 61, 64, 500, 2048, 4096 };
+
+        // Host automation, one change every 100 ms. Hosts that automate sample accurately
+        // split their blocks there, so the changes land on the same sample for every block
+        // size, and on the sub-block grid so the processor can't tell the splits apart.
+        struct Change
+        {
+            int sample;
+            const char* parameterID;
+            float value;
+        };
+
+        constexpr Change automation[] = {
+            { 4800,  "COMP",   10.0f },
+            { 9600,  "ATTACK", 1.0f },
+            { 14400, "MIX",    50.0f },
+            { 19200, "VOICE",  0.0f },
+            { 19200, "LIMIT",  1.0f },
+            { 24000, "BANDS",  3.0f },
+            { 28800, "GATE",   -40.0f },
+            { 33600, "LINK",   1.0f },
+            { 38400, "ONOFF",  0.0f },
+            { 43200, "ONOFF",  1.0f },
+            { 43200, "LEVEL",  6.0f },
+        };
+
+        static_assert ([] {
+            for (const auto& change : automation)
+                if (change.sample % PunkKompProcessor::subBlockSize != 0)
+                    return false;
+
+            return true;
+        }());
+
+        struct Render
+        {
+            juce::AudioBuffer<float> output;
+            std::vector<LevelHistory::Frame> history;
+            float gainReductionDb = 0.0f;
+        };
+
+        //==============================================================================
+        Render render (const juce::AudioBuffer<float>& input, int blockSize)
+        {
+            OfflineRenderer renderer (sampleRate, numChannels, blockSize);
+            Render result { input, {}, 0.0f };
+            auto& buffer = result.output;
+
+            auto start = 0;
+
+            for (size_t i = 0; i <= std::size (automation); ++i)
+            {
+                const auto end = i < std::size (automation) ? juce::jmin (automation[i].sample, buffer.getNumSamples()) : buffer.getNumSamples();
+
+                if (end > start)
+                {
+                    // Refers to the render's channels, no copy
+                    juce::AudioBuffer<float> piece (buffer.getArrayOfWritePointers(), numChannels, start, end - start);
+                    renderer.process (piece);
+                    start = end;
+                }
+
+                if (i < std::size (automation))
+                    renderer.setParameter (automation[i].parameterID, automation[i].value);
+            }
+
+            auto& processor = renderer.getProcessor();
+            result.gainReductionDb = processor.getGRValue();
+
+            juce::uint64 readPosition = 0;
+            result.history.resize ((size_t) processor.getLevelHistory().getWritePosition());
+            result.history.resize ((size_t) processor.getLevelHistory().pull (readPosition, result.history.data(), (int) result.history.size()));
+
+            return result;
+        }
+
+        // Describes the first way the two renders differ, or returns an empty string
+        juce::String compare (const Render& reference, const Render& other)
+        {
+            const auto difference = findLargestDifference (reference.output, other.output);
+
+            if (! difference.sameShape || difference.maxError != 0.0f)
+                return "differs by " + juce::String (difference.maxError) + " on channel " + juce::String (difference.channel)
+                       + " at sample " + juce::String (difference.sample);
+
+            if (reference.history.size() != other.history.size())
+                return "has " + juce::String ((int) other.history.size()) + " history frames instead of " + juce::String ((int) reference.history.size());
+
+            for (size_t i = 0; i < reference.history.size(); ++i)
+                if (reference.history[i].inputDb != other.history[i].inputDb || reference.history[i].reductionDb != other.history[i].reductionDb)
+                    return "has a different history frame " + juce::String ((int) i);
+
+            if (reference.gainReductionDb != other.gainReductionDb)
+                return "ends with the meter at " + juce::String (other.gainReductionDb) + " dB instead of " + juce::String (reference.gainReductionDb) + " dB";
+
+            return {};
+        }
+
+        //==============================================================================
+        void runBlockSizes()
+        {
+            juce::StringArray failures;
+
+            for (const auto& signal : TestSignals::getNames())
+            {
+                const auto input = TestSignals::make (signal, sampleRate, numChannels, seconds);
+                const auto reference = render (input, referenceBlockSize);
+                const auto numFailures = failures.size();
+
+                for (auto blockSize : otherBlockSizes)
+                {
+                    const auto problem = compare (reference, render (input, blockSize));
+
+                    if (problem.isNotEmpty())
+                        failures.add (signal + " with a block size of " + juce::String (blockSize) + " " + problem);
+                }
+
+                std::cout << signal.paddedRight (' ', 12) << (failures.size() == numFailures ? "identical" : "differs") << std::endl;
+            }
+
+            if (! failures.isEmpty())
+                juce::ConsoleApplication::fail (failures.joinIntoString ("\n"));
+
+            std::cout << "All good" << std::endl;
+        }
+    }
+
+    void addBlockSizeCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "blocksizes",
+                          "blocksizes",
+                          "Checks the output doesn't depend on the host block size",
+                          "Renders each test signal through a second of automation (compression,\n"
+                          "attack, mix, voice, limiter, bands, gate, link, bypass and level changes)\n"
+                          "at block sizes from 1 to 4096 samples, with the blocks split where the\n"
+                          "parameters change as a sample accurate host would. Fails unless the audio,\n"
+                          "the level history and the gain reduction meter all come out bit identical\n"
+                          "to the render in blocks of " + juce::String (referenceBlockSize) + " samples, the processor's sub-block size.",
+                          [] (const juce::ArgumentList&) { runBlockSizes(); } });
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace PunkKompCLI
+{
+    // Each adds its commands to the tool, see Main.cpp
+    void addRenderCommands (juce::ConsoleApplication& app);
+    void addGoldenCommand (juce::ConsoleApplication& app);
+    void addBlockSizeCommand (juce::ConsoleApplication& app);
+    void addStressCommand (juce::ConsoleApplication& app);
+    void addBenchCommand (juce::ConsoleApplication& app);
+    void addStartupCommand (juce::ConsoleApplication& app);
+    void addPaintCommand (juce::ConsoleApplication& app);
+    void addBatchCommand (juce::ConsoleApplication& app);
+    void addStreamCommand (juce::ConsoleApplication& app);
+
+    /** Parses --option=value as a number, or returns the default when the option isn't there. */
+    double getNumberForOption (const juce::ArgumentList& args, juce::StringRef option, double defaultValue);
+}
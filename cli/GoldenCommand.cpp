@@ -0,0 +1,259 @@
+#include "AudioFiles.h"
+#include "Commands.h"
+#include "OfflineRenderer.h"
+#include "TestSignals.h"
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numChannels = 2;
+        constexpr double seconds = 1.0;
+        constexpr int blockSize = 512;
+
+        // The processor runs its control work on fixed sub-blocks, so any host
+        // block size has to give exactly the same output as the golden one
+        constexpr int otherBlockSizes[] = { 61, 2048 };
+
+        struct Setting
+        {
+            const char* name;
+            float comp, attack, mix;
+            int voice, bands;
+        };
+
+        const Setting settings[] = {
+            { "default", DEFAULT_COMP, DEFAULT_ATTACK, DEFAULT_MIX, DEFAULT_VOICE, DEFAULT_BANDS },
+            { "heavy", 10.0f, 1.0f, 100.0f, 0, 1 },
+            { "light", 0.0f, 100.0f, 10.0f, 2, 1 },
+            { "multiband", 7.5f, 10.0f, 100.0f, 1, 3 },
+        };
+
+        struct Options
+        {
+            juce::File folder;
+            bool update = false;
+            double tolerance = 0.0;
+            double maxRegressionPercent = 25.0;
+            int runs = 5;
+        };
+
+        //==============================================================================
+        void applySetting (OfflineRenderer& renderer, const Setting& setting)
+        {
+            renderer.setParameter ("COMP", setting.comp);
+            renderer.setParameter ("ATTACK", setting.attack);
+            renderer.setParameter ("MIX", setting.mix);
+            renderer.setParameter ("VOICE", (float) setting.voice);
+            renderer.setParameter ("BANDS", (float) setting.bands);
+            renderer.reset(); // starts from the new values instead of ramping to them
+        }
+
+        juce::AudioBuffer<float> render (const juce::AudioBuffer<float>& input, const Setting& setting, int samplesPerBlock)
+        {
+            OfflineRenderer renderer (sampleRate, numChannels, samplesPerBlock);
+            applySetting (renderer, setting);
+
+            auto buffer = input;
+            renderer.process (buffer);
+            return buffer;
+        }
+
+        // Best of several runs, in nanoseconds per channel sample
+        double time (const juce::AudioBuffer<float>& input, const Setting& setting, int runs, juce::AudioBuffer<float>& output)
+        {
+            OfflineRenderer renderer (sampleRate, numChannels, blockSize);
+            applySetting (renderer, setting);
+
+            auto best = std::numeric_limits<double>::max();
+
+            for (int run = 0; run < runs; ++run)
+            {
+                output.makeCopyOf (input);
+                renderer.reset();
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                renderer.process (output);
+                const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+                best = juce::jmin (best, elapsed);
+            }
+
+            return best * 1.0e9 / (input.getNumSamples() * input.getNumChannels());
+        }
+
+        // Every step of the morph table stable, and the whole positions exactly the switch's voices
+        void checkVoiceMorph (juce::StringArray& failures)
+        {
+            juce::SharedResourcePointer<DspResources> resources;
+
+            for (auto rate : { 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0, 384000.0 })
+            {
+                const auto& morph = resources->getVoiceMorph (rate);
+                const auto& voices = resources->getVoiceCoefficients (rate);
+
+                if (! morph.isStable())
+                    failures.add ("The voice morph has an unstable step at " + juce::String (rate) + " Hz");
+
+                for (int voice = 0; voice < VoiceCoefficients::numVoices; ++voice)
+                {
+                    const auto& peak = voices.peak[(size_t) voice];
+                    float expected[5], morphed[5];
+                    normaliseBiquad (peak, expected);
+                    morph.getCoefficients ((float) voice, morphed);
+
+                    // A flat voice has to come out flat, as the switch skips its filter
+                    if (isIdentityBiquad (peak) ? ! isIdentityBiquad (morphed)
+                                                : ! std::equal (std::begin (expected), std::end (expected), morphed))
+                        failures.add ("The voice morph misses voice " + juce::String (voice) + " at " + juce::String (rate) + " Hz");
+                }
+            }
+        }
+
+        // The voice filters followed by their linear phase kernels, within 0.1 dB of the filters' magnitude in linear phase, at the usual sample rates
+        void checkLinearPhaseVoice (juce::StringArray& failures)
+        {
+            juce::SharedResourcePointer<DspResources> resources;
+
+            for (auto rate : { 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0, 384000.0 })
+            {
+                const auto error = resources->getVoiceLinearPhaseKernels (rate).getMaxErrorDecibels();
+
+                if (error > 0.1)
+                    failures.add ("The linear phase voice is " + juce::String (error, 3) + " dB off at " + juce::String (rate) + " Hz");
+            }
+        }
+
+        // The compressor's and the gate's tabulated curves against std::pow
+        void checkGainCurves (juce::StringArray& failures)
+        {
+            constexpr double maxErrorDecibels = 0.001;
+            juce::SharedResourcePointer<DspResources> resources;
+
+            for (auto exponent : { 1.0f / KompParameters::ratio - 1.0f, 1.0f - KompParameters::gateRatio })
+            {
+                const auto error = resources->getGainCurve (exponent).getMaxErrorDecibels();
+
+                if (error > maxErrorDecibels)
+                    failures.add ("The gain curve for an exponent of " + juce::String (exponent) + " is " + juce::String (error, 6) + " dB off std::pow");
+            }
+        }
+
+        //==============================================================================
+        void runGolden (const Options& options)
+        {
+            const auto timingsFile = options.folder.getChildFile ("timings.json");
+            const auto previousTimings = juce::JSON::parse (timingsFile);
+            juce::DynamicObject::Ptr timings (new juce::DynamicObject());
+            juce::StringArray failures;
+
+            checkVoiceMorph (failures);
+            checkLinearPhaseVoice (failures);
+            checkGainCurves (failures);
+
+            for (const auto& signal : TestSignals::getNames())
+            {
+                const auto input = TestSignals::make (signal, sampleRate, numChannels, seconds);
+
+                for (const auto& setting : settings)
+                {
+                    const auto name = signal + "_" + setting.name;
+                    juce::String report = name.paddedRight (' ', 24);
+
+                    juce::AudioBuffer<float> output;
+                    const auto nanoseconds = time (input, setting, options.runs, output);
+                    timings->setProperty (name, nanoseconds);
+
+                    for (auto otherBlockSize : otherBlockSizes)
+                        if (findLargestDifference (output, render (input, setting, otherBlockSize)).maxError != 0.0f)
+                            failures.add (name + " changes with a block size of " + juce::String (otherBlockSize));
+
+                    const auto goldenFile = options.folder.getChildFile (name + ".wav");
+
+                    if (options.update)
+                    {
+                        writeAudioFile (goldenFile, output, sampleRate);
+                        report << "written";
+                    }
+                    else if (! goldenFile.existsAsFile())
+                    {
+                        failures.add (name + " has no golden file, run with --update first");
+                        report << "no golden";
+                    }
+                    else
+                    {
+                        const auto difference = findLargestDifference (output, readAudioFile (goldenFile).buffer);
+
+                        if (! difference.sameShape || difference.maxError > options.tolerance)
+                            failures.add (name + " differs from its golden file by " + juce::String (difference.maxError));
+
+                        report << "max difference " << juce::String (difference.maxError, 7);
+                    }
+
+                    report << "   " << juce::String (nanoseconds, 2) << " ns/sample";
+
+                    if (previousTimings.hasProperty (name))
+                    {
+                        const auto previous = (double) previousTimings[juce::Identifier (name)];
+                        const auto change = 100.0 * (nanoseconds / previous - 1.0);
+                        report << " (" << (change >= 0.0 ? "+" : "") << juce::String (change, 1) << "%)";
+
+                        if (! options.update && change > options.maxRegressionPercent)
+                            failures.add (name + " got " + juce::String (change, 1) + "% slower");
+                    }
+
+                    std::cout << report << std::endl;
+                }
+            }
+
+            if (options.update)
+                timingsFile.replaceWithText (juce::JSON::toString (juce::var (timings.get())));
+
+            if (! failures.isEmpty())
+                juce::ConsoleApplication::fail (failures.joinIntoString ("\n"));
+
+            std::cout << "All good" << std::endl;
+        }
+    }
+
+    void addGoldenCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "golden",
+                          "golden --dir=<folder> [--update] [--tolerance=0] [--max-regression=25] [--runs=5]",
+                          "Checks renders of the built-in test signals against stored ones",
+                          "Renders a second of every test signal with a handful of settings and\n"
+                          "compares the result with the WAV files in the folder (the repo's golden\n"
+                          "folder holds them), failing on any difference over the tolerance. By\n"
+                          "default the output has to be bit identical: the DC blocking high pass\n"
+                          "turns any change in the rounding into differences around 1e-3, so a\n"
+                          "looser tolerance would hide real changes too. A deliberate reordering of\n"
+                          "the maths, or a build for a target that fuses multiplies and adds, is\n"
+                          "checked with an explicit --tolerance instead.\n\n"
+                          "Each render is also repeated at other block sizes and has to come out\n"
+                          "bit identical, and is timed (best of --runs). A render more than\n"
+                          "--max-regression percent slower than the stored timing fails. The voice\n"
+                          "morph's tables are checked for stability, and the linear phase voice's\n"
+                          "kernels against the voice filters, at the usual sample rates. The gain\n"
+                          "curve tables have to be within 0.001 dB of std::pow.\n\n"
+                          "--update writes new golden files and timings instead. Timings only mean\n"
+                          "something on the machine that wrote them, so timings.json stays out of\n"
+                          "the repo.",
+                          [] (const juce::ArgumentList& args)
+                          {
+                              Options options;
+                              options.folder = args.getFileForOption ("--dir");
+                              options.update = args.containsOption ("--update");
+                              options.tolerance = getNumberForOption (args, "--tolerance", options.tolerance);
+                              options.maxRegressionPercent = getNumberForOption (args, "--max-regression", options.maxRegressionPercent);
+                              options.runs = juce::jmax (1, (int) getNumberForOption (args, "--runs", options.runs));
+
+                              if (options.update)
+                                  options.folder.createDirectory();
+                              else if (! options.folder.isDirectory())
+                                  juce::ConsoleApplication::fail ("No golden folder at " + options.folder.getFullPathName() + ", run with --update first");
+
+                              runGolden (options);
+                          } });
+    }
+}
@@ -0,0 +1,24 @@
+#include "Commands.h"
+
+#include <juce_events/juce_events.h>
+
+int main (int argc, char* argv[])
+{
+    // The processor owns an editor-less APVTS, but JUCE still wants the message manager around
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand ("--help|-h", "PunkKomp offline tool\n\nUsage: PunkKompCLI <command> [options]", true);
+
+    PunkKompCLI::addRenderCommands (app);
+    PunkKompCLI::addGoldenCommand (app);
+    PunkKompCLI::addBlockSizeCommand (app);
+    PunkKompCLI::addStressCommand (app);
+    PunkKompCLI::addBenchCommand (app);
+    PunkKompCLI::addStartupCommand (app);
+    PunkKompCLI::addPaintCommand (app);
+    PunkKompCLI::addBatchCommand (app);
+    PunkKompCLI::addStreamCommand (app);
+
+    return app.findAndRunCommand (juce::ArgumentList (argc, argv), true);
+}
@@ -0,0 +1,96 @@
+#include "OfflineRenderer.h"
+
+namespace PunkKompCLI
+{
+    OfflineRenderer::OfflineRenderer (double rate, int channels, int samplesPerBlock)
+        : sampleRate (rate), numChannels (channels), blockSize (samplesPerBlock)
+    {
+        jassert (blockSize > 0);
+
+        const auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels).isDisabled()
+                                    ? juce::AudioChannelSet::discreteChannels (numChannels)
+                                    : juce::AudioChannelSet::canonicalChannelSet (numChannels);
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (channelSet);
+        layout.outputBuses.add (channelSet);
+
+        if (! processor.setBusesLayout (layout))
+            juce::ConsoleApplication::fail ("PunkKomp doesn't support " + juce::String (numChannels) + " channels");
+
+        processor.setNonRealtime (true);
+        reset();
+    }
+
+    void OfflineRenderer::setParameter (const juce::String& parameterID, float value)
+    {
+        auto* parameter = processor.state.getParameter (parameterID);
+
+        if (parameter == nullptr)
+            juce::ConsoleApplication::fail ("Unknown parameter " + parameterID);
+
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    void OfflineRenderer::setParameters (const juce::ArgumentList& args)
+    {
+        for (auto* parameter : processor.getParameters())
+        {
+            if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*> (parameter))
+            {
+                const auto option = "--" + withID->paramID.toLowerCase();
+
+                if (args.containsOption (option))
+                    setParameter (withID->paramID, args.getValueForOption (option).getFloatValue());
+            }
+        }
+
+        reset();
+    }
+
+    void OfflineRenderer::reset()
+    {
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+    }
+
+    void OfflineRenderer::process (juce::AudioBuffer<float>& buffer)
+    {
+        jassert (buffer.getNumChannels() == numChannels);
+
+        for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+        {
+            const auto length = juce::jmin (blockSize, buffer.getNumSamples() - start);
+
+            // Refers to the caller's channels, no copy
+            juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, start, length);
+            processor.processBlock (block, midi);
+        }
+    }
+
+    void OfflineRenderer::compensateLatency (juce::AudioBuffer<float>& buffer)
+    {
+        jassert (buffer.getNumChannels() == numChannels);
+
+        const auto latency = getLatencySamples();
+
+        if (latency == 0)
+            return;
+
+        juce::AudioBuffer<float> tail (numChannels, latency);
+        tail.clear();
+        process (tail);
+
+        // What's left of the buffer after the first latency samples, then the tail, which is all of
+        // the output for a buffer shorter than the latency
+        const auto numSamples = buffer.getNumSamples();
+        const auto kept = juce::jmax (0, numSamples - latency);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* samples = buffer.getWritePointer (ch);
+            std::memmove (samples, samples + latency, (size_t) kept * sizeof (float));
+            buffer.copyFrom (ch, kept, tail, ch, latency - (numSamples - kept), numSamples - kept);
+        }
+    }
+}
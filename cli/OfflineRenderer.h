@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PluginProcessor.h"
+
+namespace PunkKompCLI
+{
+    //==============================================================================
+    /**
+        Runs a PunkKompProcessor over whole buffers without a host, the way a DAW
+        bounce would: parameters are set through the APVTS, and the buffer is
+        handed to processBlock in host-sized pieces without being copied.
+    */
+    class OfflineRenderer
+    {
+    public:
+        OfflineRenderer (double sampleRate, int numChannels, int blockSize);
+
+        /** Sets a parameter by ID (e.g. "COMP") to a plain, unnormalised value. */
+        void setParameter (const juce::String& parameterID, float value);
+
+        /** Applies every --<parameter id>=<value> option found in the arguments, e.g. --comp=7.5, then
+            resets, so the render starts from them (and with their latency) instead of ramping to them.
+        */
+        void setParameters (const juce::ArgumentList& args);
+
+        /** Calls prepareToPlay again, which clears all the DSP state. */
+        void reset();
+
+        /** Processes the buffer in place, blockSize samples at a time. */
+        void process (juce::AudioBuffer<float>& buffer);
+
+        /** Takes the latency back out of a buffer process has just rendered, as a host's delay
+            compensation would: the output moves forward by getLatencySamples(), and the end that
+            moves up is rendered on from silence.
+        */
+        void compensateLatency (juce::AudioBuffer<float>& buffer);
+
+        /** How late the output comes out, in samples (the limiter's lookahead and the linear phase voice's delay). */
+        int getLatencySamples() const noexcept { return processor.getLatencySamples(); }
+
+        PunkKompProcessor& getProcessor() noexcept { return processor; }
+        int getBlockSize() const noexcept { return blockSize; }
+
+    private:
+        PunkKompProcessor processor;
+        double sampleRate;
+        int numChannels, blockSize;
+        juce::MidiBuffer midi;
+    };
+}
@@ -0,0 +1,131 @@
+#include "Commands.h"
+#include "PluginEditor.h"
+
+#include <numeric>
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+
+        // Editor sizes (times the 180x320 layout) and the screen scales they're painted at
+        struct Size
+        {
+            int editorScale;
+            float screenScale;
+        };
+
+        const Size sizes[] = { { 1, 1.0f }, { 1, 2.0f }, { 2, 1.0f }, { 2, 2.0f }, { 4, 1.0f } };
+
+        double percentile (std::vector<double> times, double fraction)
+        {
+            std::sort (times.begin(), times.end());
+            return times[(size_t) juce::jmin ((double) times.size() - 1.0, fraction * (double) times.size())];
+        }
+
+        template <typename ComponentType>
+        juce::Component& findChild (juce::Component& parent, std::function<bool (ComponentType&)> matches = nullptr)
+        {
+            for (auto* child : parent.getChildren())
+                if (auto* c = dynamic_cast<ComponentType*> (child); c != nullptr && (matches == nullptr || matches (*c)))
+                    return *c;
+
+            juce::ConsoleApplication::fail ("The editor has changed, the paint command can't find what it repaints");
+            return parent;
+        }
+
+        //==============================================================================
+        void runPaint (const juce::ArgumentList& args)
+        {
+            const auto numFrames = juce::jmax (10, (int) getNumberForOption (args, "--frames", 200));
+
+            PunkKompProcessor processor;
+            processor.setRateAndBufferSizeDetails (sampleRate, 512);
+            processor.prepareToPlay (sampleRate, 512);
+
+            std::unique_ptr<juce::AudioProcessorEditor> editor (processor.createEditorIfNeeded());
+            auto& punkEditor = dynamic_cast<PunkKompEditor&> (*editor);
+
+            // What a frame repaints: the meter, which the editor's timer repaints, and a knob being turned
+            auto& meter = findChild<juce::Gui::GainReductionMeter> (*editor);
+            auto& knob = findChild<juce::Slider> (*editor, [] (juce::Slider& s) { return s.isRotary(); });
+
+            auto paintTime = 0.0;
+            punkEditor.onPaintMeasured = [&paintTime] (double milliseconds) { paintTime += milliseconds; };
+
+            const auto paint = [&] (juce::Rectangle<int> area, float screenScale)
+            {
+                paintTime = 0.0;
+                editor->createComponentSnapshot (area, true, screenScale);
+                return paintTime;
+            };
+
+            std::cout << "paint() in ms per frame over " << numFrames << " frames, budget " << PunkKompEditor::paintBudgetMs << " ms\n\n"
+                      << juce::String ("size").paddedRight (' ', 20)
+                      << juce::String ("average").paddedRight (' ', 10)
+                      << juce::String ("95%").paddedRight (' ', 10)
+                      << juce::String ("max").paddedRight (' ', 10)
+                      << juce::String ("over budget").paddedRight (' ', 14)
+                      << "full repaint" << std::endl;
+
+            juce::StringArray failures;
+
+            for (const auto& size : sizes)
+            {
+                punkEditor.setSize (PunkKompEditor::baseWidth * size.editorScale, PunkKompEditor::baseHeight * size.editorScale);
+
+                // The first repaint at a new size resamples the images, and full repaints only come with
+                // a resize or the window being uncovered, so they're shown but not held to the budget
+                paint (editor->getLocalBounds(), size.screenScale);
+                const auto fullRepaint = paint (editor->getLocalBounds(), size.screenScale);
+
+                std::vector<double> times;
+
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    punkEditor.timerCallback();
+                    times.push_back (paint (meter.getBounds(), size.screenScale) + paint (knob.getBounds(), size.screenScale));
+                }
+
+                const auto name = juce::String (editor->getWidth()) + "x" + juce::String (editor->getHeight()) + " at " + juce::String (size.screenScale) + "x";
+                const auto average = std::accumulate (times.begin(), times.end(), 0.0) / (double) times.size();
+                const auto typical = percentile (times, 0.95);
+                const auto numOverBudget = std::count_if (times.begin(), times.end(), [] (double t) { return t > PunkKompEditor::paintBudgetMs; });
+
+                std::cout << name.paddedRight (' ', 20)
+                          << juce::String (average, 3).paddedRight (' ', 10)
+                          << juce::String (typical, 3).paddedRight (' ', 10)
+                          << juce::String (percentile (times, 1.0), 3).paddedRight (' ', 10)
+                          << juce::String ((int) numOverBudget).paddedRight (' ', 14)
+                          << juce::String (fullRepaint, 3) << std::endl;
+
+                // A frame now and then can lose the CPU, one in twenty over the budget can't
+                if (typical > PunkKompEditor::paintBudgetMs)
+                    failures.add (name + " takes " + juce::String (typical, 3) + " ms for 95% of its frames, over the "
+                                  + juce::String (PunkKompEditor::paintBudgetMs) + " ms budget");
+            }
+
+            processor.editorBeingDeleted (editor.get());
+
+            if (! failures.isEmpty())
+                juce::ConsoleApplication::fail (failures.joinIntoString ("\n"));
+
+            std::cout << "\nAll good" << std::endl;
+        }
+    }
+
+    void addPaintCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "paint",
+                          "paint [--frames=200]",
+                          "Checks the editor paints within its per frame budget",
+                          "Opens the editor at several sizes and screen scales and paints what a frame\n"
+                          "repaints, the meter after the editor's timer and a knob being turned, frame\n"
+                          "after frame, timing paint() through its onPaintMeasured hook. Fails if more\n"
+                          "than one frame in twenty goes over PunkKompEditor::paintBudgetMs at any size.\n"
+                          "Full repaints, which only come with a resize or the window being uncovered,\n"
+                          "are printed but not held to the budget.",
+                          [] (const juce::ArgumentList& args) { runPaint (args); } });
+    }
+}
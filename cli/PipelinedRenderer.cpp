@@ -0,0 +1,193 @@
+#include "PipelinedRenderer.h"
+
+#include <thread>
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        double secondsSince (juce::int64 start)
+        {
+            return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        }
+
+        // Chunk indices from one stage to the next. Only the waiting uses an event, the queue itself is lock free.
+        class Queue
+        {
+        public:
+            explicit Queue (int capacity)
+                : fifo (capacity + 1), slots ((size_t) capacity + 1)
+            {
+            }
+
+            void push (int chunk, double& waitingSeconds)
+            {
+                waitUntil ([this] { return fifo.getFreeSpace() > 0; }, spaceAvailable, waitingSeconds);
+                fifo.write (1).forEach ([this, chunk] (int index) { slots[(size_t) index] = chunk; });
+                chunkAvailable.signal();
+            }
+
+            int pop (double& waitingSeconds)
+            {
+                waitUntil ([this] { return fifo.getNumReady() > 0; }, chunkAvailable, waitingSeconds);
+
+                auto chunk = 0;
+                fifo.read (1).forEach ([this, &chunk] (int index) { chunk = slots[(size_t) index]; });
+                spaceAvailable.signal();
+
+                return chunk;
+            }
+
+        private:
+            // The events remember a signal that came before the wait, so none is missed
+            template <typename Condition>
+            static void waitUntil (Condition&& condition, juce::WaitableEvent& event, double& waitingSeconds)
+            {
+                if (condition())
+                    return;
+
+                const auto start = juce::Time::getHighResolutionTicks();
+
+                while (! condition())
+                    event.wait();
+
+                waitingSeconds += secondsSince (start);
+            }
+
+            juce::AbstractFifo fifo;
+            std::vector<int> slots;
+            juce::WaitableEvent chunkAvailable, spaceAvailable;
+        };
+    }
+
+    //==============================================================================
+    PipelinedRenderer::PipelinedRenderer (OfflineRenderer& offlineRenderer, const Options& renderOptions)
+        : renderer (offlineRenderer), options (renderOptions)
+    {
+        jassert (options.chunkSize > 0 && options.numChunks > 1);
+    }
+
+    PipelinedRenderer::Stats PipelinedRenderer::process (juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer)
+    {
+        const auto numChannels = (int) reader.numChannels;
+        const auto chunkSize = options.chunkSize;
+        const auto latency = renderer.getLatencySamples();
+        const auto length = reader.lengthInSamples + latency;    // the silence flushes the end out
+
+        // All the memory the render uses, whatever the file length
+        std::vector<juce::AudioBuffer<float>> chunks ((size_t) options.numChunks);
+        std::vector<int> chunkLengths (chunks.size());
+
+        Stats stats;
+        std::atomic<bool> readFailed { false }, writeFailed { false };
+
+        // Every chunk starts out free, the read-ahead is as deep as the pool
+        Queue free (options.numChunks), toProcess (options.numChunks), toWrite (options.numChunks);
+
+        for (int i = 0; i < options.numChunks; ++i)
+        {
+            chunks[(size_t) i].setSize (numChannels, chunkSize);
+            free.push (i, stats.read.waitingSeconds);
+        }
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        // Fills whatever chunks come back, and ends with an empty one
+        std::thread readThread ([&]
+        {
+            for (juce::int64 position = 0;;)
+            {
+                const auto chunk = free.pop (stats.read.waitingSeconds);
+                auto numSamples = (int) juce::jmin ((juce::int64) chunkSize, length - position);
+
+                // Past the end of the file it's silence
+                const auto fileSamples = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numSamples, reader.lengthInSamples - position);
+                const auto busyStart = juce::Time::getHighResolutionTicks();
+
+                if (fileSamples > 0 && ! reader.read (&chunks[(size_t) chunk], 0, fileSamples, position, true, true))
+                {
+                    readFailed = true;
+                    numSamples = 0;
+                }
+                else
+                {
+                    chunks[(size_t) chunk].clear (fileSamples, numSamples - fileSamples);
+                }
+
+                stats.read.busySeconds += secondsSince (busyStart);
+                stats.read.samples += numSamples;
+                position += numSamples;
+
+                chunkLengths[(size_t) chunk] = numSamples;
+                toProcess.push (chunk, stats.read.waitingSeconds);
+
+                if (numSamples == 0)
+                    return;
+            }
+        });
+
+        // Writes and recycles, until the empty chunk. After a failed write it only recycles, so the other stages can finish.
+        std::thread writeThread ([&]
+        {
+            for (auto toDrop = latency;;)
+            {
+                const auto chunk = toWrite.pop (stats.write.waitingSeconds);
+                const auto numSamples = chunkLengths[(size_t) chunk];
+
+                if (numSamples == 0)
+                    return;
+
+                const auto busyStart = juce::Time::getHighResolutionTicks();
+                const auto dropped = juce::jmin (toDrop, numSamples);
+                toDrop -= dropped;
+
+                if (! writeFailed && dropped < numSamples && ! writer.writeFromAudioSampleBuffer (chunks[(size_t) chunk], dropped, numSamples - dropped))
+                    writeFailed = true;
+
+                stats.write.busySeconds += secondsSince (busyStart);
+                stats.write.samples += numSamples;
+
+                free.push (chunk, stats.write.waitingSeconds);
+            }
+        });
+
+        // The DSP stage runs on the calling thread
+        for (;;)
+        {
+            const auto chunk = toProcess.pop (stats.process.waitingSeconds);
+            const auto numSamples = chunkLengths[(size_t) chunk];
+
+            if (numSamples > 0)
+            {
+                const auto busyStart = juce::Time::getHighResolutionTicks();
+
+                juce::AudioBuffer<float> samples (chunks[(size_t) chunk].getArrayOfWritePointers(), numChannels, numSamples);
+                renderer.process (samples);
+
+                stats.process.busySeconds += secondsSince (busyStart);
+                stats.process.samples += numSamples;
+            }
+
+            toWrite.push (chunk, stats.process.waitingSeconds);
+
+            if (numSamples == 0)
+                break;
+        }
+
+        readThread.join();
+        writeThread.join();
+
+        if (! writeFailed && ! writer.flush())
+            writeFailed = true;
+
+        stats.seconds = secondsSince (start);
+
+        if (readFailed)
+            juce::ConsoleApplication::fail ("Couldn't read the input file");
+
+        if (writeFailed)
+            juce::ConsoleApplication::fail ("Couldn't write the output file");
+
+        return stats;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "OfflineRenderer.h"
+
+namespace PunkKompCLI
+{
+    //==============================================================================
+    /**
+        Streams a file through an OfflineRenderer in three stages, each on its
+        own thread: reading and decoding ahead, processing, then encoding and
+        writing behind.
+
+        The stages pass chunks from a fixed pool of buffers to each other over
+        bounded single producer, single consumer queues (juce::AbstractFifo, no
+        locks), and the writer hands every chunk back to the reader to refill.
+        A stage with nothing to take or no room to give waits, so the reader
+        can only run as far ahead as the pool allows and memory stays the same
+        whatever the file length. The DSP only ever waits when the read-ahead
+        has run dry or the write-behind is full.
+
+        The renderer's latency is taken back out on the way: the reader carries
+        on past the end of the file with that much silence, and the writer drops
+        that much from the start.
+    */
+    class PipelinedRenderer
+    {
+    public:
+        struct Options
+        {
+            int chunkSize = 16384;      // samples per channel
+            int numChunks = 8;          // read-ahead and write-behind share these
+        };
+
+        struct Stage
+        {
+            const char* name = "";
+            juce::int64 samples = 0;
+            double busySeconds = 0.0;
+            double waitingSeconds = 0.0;    // on an empty input queue or a full output queue
+        };
+
+        struct Stats
+        {
+            Stage read { "read" }, process { "process" }, write { "write" };
+            double seconds = 0.0;
+        };
+
+        PipelinedRenderer (OfflineRenderer& renderer, const Options& options);
+
+        /** Renders the reader's whole file into the writer. Fails the command if either of them fails. */
+        Stats process (juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer);
+
+    private:
+        OfflineRenderer& renderer;
+        Options options;
+    };
+}
@@ -0,0 +1,153 @@
+#include "AudioFiles.h"
+#include "Commands.h"
+#include "PipelinedRenderer.h"
+#include "SegmentRenderer.h"
+
+namespace PunkKompCLI
+{
+    double getNumberForOption (const juce::ArgumentList& args, juce::StringRef option, double defaultValue)
+    {
+        return args.containsOption (option) ? args.getValueForOption (option).getDoubleValue() : defaultValue;
+    }
+
+    namespace
+    {
+        // The whole file in memory, one segment per thread
+        void renderInSegments (const juce::ArgumentList& args, juce::AudioFormatReader& reader, int blockSize, const SegmentRenderer::Options& options)
+        {
+            const auto seamTolerance = (float) getNumberForOption (args, "--seam-tolerance", 1.0e-4);
+
+            AudioFile input;
+            input.sampleRate = reader.sampleRate;
+            input.buffer.setSize ((int) reader.numChannels, (int) reader.lengthInSamples);
+            reader.read (&input.buffer, 0, input.buffer.getNumSamples(), 0, true, true);
+
+            SegmentRenderer renderer (input.sampleRate, input.buffer.getNumChannels(), blockSize,
+                                      [&args] (OfflineRenderer& segment) { segment.setParameters (args); });
+
+            auto buffer = input.buffer;
+            const auto seams = renderer.process (buffer, options);
+
+            if (! seams.empty())
+            {
+                const auto worst = std::max_element (seams.begin(), seams.end(), [] (const auto& a, const auto& b) { return a.difference < b.difference; });
+
+                std::cout << "Rendered in " << seams.size() + 1 << " segments, largest seam difference " << worst->difference
+                          << " (" << juce::Decibels::gainToDecibels (worst->difference) << " dB) at sample " << worst->sample << std::endl;
+
+                // Some setting the pre-roll can't settle: the serial render is always right
+                if (worst->difference > seamTolerance)
+                {
+                    std::cout << "Over the seam tolerance of " << seamTolerance << ", rendering serially" << std::endl;
+
+                    buffer = input.buffer;
+                    renderer.process (buffer, {});
+                }
+            }
+
+            writeAudioFile (args[2].resolveAsFile(), buffer, input.sampleRate);
+        }
+
+        // One renderer, fed a chunk at a time while the next chunks are read and the last ones written
+        void renderStreaming (const juce::ArgumentList& args, juce::AudioFormatReader& reader, int blockSize)
+        {
+            PipelinedRenderer::Options options;
+            options.chunkSize = juce::jmax (1, (int) getNumberForOption (args, "--chunk", options.chunkSize));
+            options.numChunks = juce::jmax (2, (int) getNumberForOption (args, "--chunks", options.numChunks));
+
+            OfflineRenderer renderer (reader.sampleRate, (int) reader.numChannels, blockSize);
+            renderer.setParameters (args);
+
+            const auto writer = createAudioFileWriter (args[2].resolveAsFile(), reader.sampleRate, (int) reader.numChannels);
+            const auto stats = PipelinedRenderer (renderer, options).process (reader, *writer);
+
+            if (! args.containsOption ("--stats"))
+                return;
+
+            std::cout << "Rendered " << juce::String ((double) stats.process.samples / reader.sampleRate, 1) << " s of audio in "
+                      << juce::String (stats.seconds, 3) << " s\n" << std::endl;
+
+            for (const auto* stage : { &stats.read, &stats.process, &stats.write })
+            {
+                const auto audioSeconds = (double) stage->samples / reader.sampleRate;
+
+                std::cout << juce::String (stage->name).paddedRight (' ', 10)
+                          << "busy " << juce::String (stage->busySeconds, 3) << " s ("
+                          << juce::roundToInt (audioSeconds / juce::jmax (1.0e-9, stage->busySeconds)) << "x real time), "
+                          << "waiting " << juce::String (stage->waitingSeconds, 3) << " s" << std::endl;
+            }
+        }
+
+        void render (const juce::ArgumentList& args)
+        {
+            const auto reader = createAudioFileReader (args[1].resolveAsExistingFile());
+            const auto blockSize = (int) getNumberForOption (args, "--block", 512);
+
+            if (blockSize < 1)
+                juce::ConsoleApplication::fail ("--block must be at least 1");
+
+            SegmentRenderer::Options options;
+            options.numThreads = (int) getNumberForOption (args, "--threads", juce::SystemStats::getNumCpus());
+            options.preRollSeconds = getNumberForOption (args, "--preroll", options.preRollSeconds);
+
+            // Segments need the whole file in one buffer, a serial render streams it in bounded memory
+            if (reader->lengthInSamples <= std::numeric_limits<int>::max()
+                && SegmentRenderer::getNumSegments (reader->lengthInSamples, reader->sampleRate, options) > 1)
+                renderInSegments (args, *reader, blockSize, options);
+            else
+                renderStreaming (args, *reader, blockSize);
+        }
+
+        void compare (const juce::ArgumentList& args)
+        {
+            const auto a = readAudioFile (args[1].resolveAsExistingFile());
+            const auto b = readAudioFile (args[2].resolveAsExistingFile());
+            const auto tolerance = getNumberForOption (args, "--tolerance", 0.0);
+            const auto difference = findLargestDifference (a.buffer, b.buffer);
+
+            if (! difference.sameShape || a.sampleRate != b.sampleRate)
+                juce::ConsoleApplication::fail ("The files have different lengths, channel counts or sample rates");
+
+            std::cout << "Largest difference " << difference.maxError
+                      << " (" << juce::Decibels::gainToDecibels (difference.maxError) << " dB)"
+                      << " at channel " << difference.channel << ", sample " << difference.sample << std::endl;
+
+            if (difference.maxError > tolerance)
+                juce::ConsoleApplication::fail ("Over the tolerance of " + juce::String (tolerance));
+        }
+    }
+
+    void addRenderCommands (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "render",
+                          "render <input> <output> [--block=512] [--threads=<cpus>] [--preroll=3] [--seam-tolerance=1e-4] [--chunk=16384] [--chunks=8] [--stats] [--comp=5 --attack=30 ...]",
+                          "Processes a file through PunkKomp",
+                          "Renders the input file offline and writes the result as 32 bit float WAV.\n"
+                          "--block sets the host block size. Any parameter can be set with\n"
+                          "--<parameter id>=<value> in its own units, e.g. --comp=7.5 --voice=2 --bands=3.\n"
+                          "Long files are cut into one segment per thread, each warmed up on --preroll\n"
+                          "seconds of the audio before it. Every seam is checked against a render with\n"
+                          "four times the pre-roll, and if one differs by more than --seam-tolerance the\n"
+                          "file is rendered again serially. --threads=1 always renders serially.\n"
+                          "A serial render streams the file through three threads (read ahead, process,\n"
+                          "write behind) sharing --chunks buffers of --chunk samples, so memory stays\n"
+                          "bounded. --stats prints each stage's busy and waiting time.\n"
+                          "The plugin's latency (LIMIT, LINEAR) is taken back out, so the output lines\n"
+                          "up with the input and is as long as it.",
+                          [] (const juce::ArgumentList& args)
+                          {
+                              args.checkMinNumArguments (3);
+                              render (args);
+                          } });
+
+        app.addCommand ({ "compare",
+                          "compare <a> <b> [--tolerance=0]",
+                          "Prints the largest sample difference between two files",
+                          "Fails when the files differ in shape or by more than the tolerance.",
+                          [] (const juce::ArgumentList& args)
+                          {
+                              args.checkMinNumArguments (3);
+                              compare (args);
+                          } });
+    }
+}
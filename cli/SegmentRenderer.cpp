@@ -0,0 +1,135 @@
+#include "SegmentRenderer.h"
+#include "AudioFiles.h"
+
+#include <thread>
+
+namespace PunkKompCLI
+{
+    struct SegmentRenderer::Segment
+    {
+        int start = 0, end = 0;
+        int preRoll = 0;
+
+        // The untouched input from the start of the check's pre-roll to the end of the check
+        juce::AudioBuffer<float> input;
+        int inputStart = 0;
+
+        std::unique_ptr<OfflineRenderer> renderer, checkRenderer;
+        Seam seam;
+    };
+
+    SegmentRenderer::SegmentRenderer (double rate, int channels, int samplesPerBlock, SetUp setUpRenderer)
+        : sampleRate (rate), numChannels (channels), blockSize (samplesPerBlock), setUp (std::move (setUpRenderer))
+    {
+    }
+
+    std::unique_ptr<OfflineRenderer> SegmentRenderer::createRenderer() const
+    {
+        auto renderer = std::make_unique<OfflineRenderer> (sampleRate, numChannels, blockSize);
+
+        if (setUp != nullptr)
+            setUp (*renderer);
+
+        return renderer;
+    }
+
+    int SegmentRenderer::getNumSegments (juce::int64 numSamples, double sampleRate, const Options& options)
+    {
+        const auto preRoll = juce::jmax (1, juce::roundToInt (options.preRollSeconds * sampleRate));
+        return (int) juce::jlimit ((juce::int64) 1, (juce::int64) juce::jmax (1, options.numThreads), numSamples / (4 * preRoll));
+    }
+
+    std::vector<SegmentRenderer::Seam> SegmentRenderer::process (juce::AudioBuffer<float>& buffer, const Options& options)
+    {
+        jassert (buffer.getNumChannels() == numChannels);
+
+        const auto numSamples = buffer.getNumSamples();
+        const auto preRoll = juce::jmax (1, juce::roundToInt (options.preRollSeconds * sampleRate));
+        const auto checkPreRoll = 4 * preRoll;
+        const auto checkLength = juce::jmax (1, juce::roundToInt (options.checkSeconds * sampleRate));
+        const auto numSegments = getNumSegments (numSamples, sampleRate, options);
+
+        if (numSegments == 1)
+        {
+            const auto renderer = createRenderer();
+            renderer->process (buffer);
+            renderer->compensateLatency (buffer);
+            return {};
+        }
+
+        // A segment's pre-roll and check read samples its neighbour is overwriting, so they get copies
+        // up front. The renderers are made here as well, on the message thread.
+        std::vector<Segment> segments ((size_t) numSegments);
+
+        for (int i = 0; i < numSegments; ++i)
+        {
+            auto& segment = segments[(size_t) i];
+            segment.start = (int) ((juce::int64) numSamples * i / numSegments);
+            segment.end = (int) ((juce::int64) numSamples * (i + 1) / numSegments);
+            segment.renderer = createRenderer();
+
+            if (i == 0)
+                continue;
+
+            segment.preRoll = preRoll;
+            segment.inputStart = juce::jmax (0, segment.start - checkPreRoll);
+
+            const auto inputLength = juce::jmin (segment.end, segment.start + checkLength) - segment.inputStart;
+            segment.input.setSize (numChannels, inputLength);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                segment.input.copyFrom (ch, 0, buffer, ch, segment.inputStart, inputLength);
+
+            segment.checkRenderer = createRenderer();
+        }
+
+        std::vector<std::thread> threads;
+
+        for (auto& segment : segments)
+            threads.emplace_back ([this, &segment, &buffer] { renderSegment (segment, buffer); });
+
+        for (auto& thread : threads)
+            thread.join();
+
+        // The last segment's renderer is where a serial render would be at the end of the buffer
+        segments.back().renderer->compensateLatency (buffer);
+
+        std::vector<Seam> seams;
+
+        for (size_t i = 1; i < segments.size(); ++i)
+            seams.push_back (segments[i].seam);
+
+        return seams;
+    }
+
+    void SegmentRenderer::renderSegment (Segment& segment, juce::AudioBuffer<float>& buffer) const
+    {
+        const auto offset = segment.start - segment.inputStart;
+
+        // Warm up on the pre-roll, its output isn't needed
+        if (segment.preRoll > 0)
+        {
+            juce::AudioBuffer<float> preRoll (numChannels, segment.preRoll);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                preRoll.copyFrom (ch, 0, segment.input, ch, offset - segment.preRoll, segment.preRoll);
+
+            segment.renderer->process (preRoll);
+        }
+
+        juce::AudioBuffer<float> samples (buffer.getArrayOfWritePointers(), numChannels, segment.start, segment.end - segment.start);
+        segment.renderer->process (samples);
+
+        if (segment.checkRenderer == nullptr)
+            return;
+
+        // The same samples after the longer pre-roll, which the check's copy of the input is the last use of
+        segment.checkRenderer->process (segment.input);
+
+        const auto checkLength = segment.input.getNumSamples() - offset;
+        const juce::AudioBuffer<float> rendered (buffer.getArrayOfWritePointers(), numChannels, segment.start, checkLength);
+        const juce::AudioBuffer<float> reference (segment.input.getArrayOfWritePointers(), numChannels, offset, checkLength);
+
+        segment.seam = { segment.start, findLargestDifference (reference, rendered).maxError };
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "OfflineRenderer.h"
+
+namespace PunkKompCLI
+{
+    //==============================================================================
+    /**
+        Renders one long buffer on several cores: the buffer is cut into one
+        segment per thread, and each segment is rendered by an OfflineRenderer of
+        its own.
+
+        PunkKomp forgets quickly (a 50 ms release, a 10 Hz high pass, parameter
+        ramps of 0.1 s), so every segment but the first starts a pre-roll early,
+        and the output of the pre-roll is thrown away. By the segment's first
+        sample its detector and filters are where a serial render would have
+        them, usually to the bit.
+
+        Every seam is checked afterwards. The samples just after it are rendered
+        again with a pre-roll four times as long, and the largest difference from
+        the segment's output is reported.
+
+        The segments all come out late by the same latency, which the last one's
+        renderer takes back out of the whole buffer once they're done
+        (OfflineRenderer::compensateLatency).
+    */
+    class SegmentRenderer
+    {
+    public:
+        /** Called on every renderer the segments use, e.g. to set the parameters. */
+        using SetUp = std::function<void (OfflineRenderer&)>;
+
+        struct Options
+        {
+            int numThreads = 1;
+            double preRollSeconds = 3.0;    // the last bits take longer to agree than the time constants suggest
+            double checkSeconds = 0.25;     // rendered again after each seam
+        };
+
+        struct Seam
+        {
+            int sample = 0;
+            float difference = 0.0f;
+        };
+
+        SegmentRenderer (double sampleRate, int numChannels, int blockSize, SetUp setUp);
+
+        /** How many segments process cuts numSamples into, 1 for a serial render. */
+        static int getNumSegments (juce::int64 numSamples, double sampleRate, const Options& options);
+
+        /** Processes the buffer in place. Segments are never shorter than four pre-rolls, so a short
+            buffer gets fewer of them than there are threads, or is rendered serially. Returns the seams,
+            none for a serial render.
+        */
+        std::vector<Seam> process (juce::AudioBuffer<float>& buffer, const Options& options);
+
+    private:
+        struct Segment;
+
+        std::unique_ptr<OfflineRenderer> createRenderer() const;
+        void renderSegment (Segment& segment, juce::AudioBuffer<float>& buffer) const;
+
+        double sampleRate;
+        int numChannels, blockSize;
+        SetUp setUp;
+    };
+}
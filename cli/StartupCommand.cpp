@@ -0,0 +1,133 @@
+#include "Commands.h"
+#include "PluginProcessor.h"
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+
+        enum Phase
+        {
+            construct,
+            prepare,
+            firstBlock,
+            openEditor,
+            prepareAgain,
+            numPhases
+        };
+
+        const char* const phaseNames[] = { "construct", "prepareToPlay", "first processBlock", "open editor", "prepareToPlay again" };
+
+        double secondsSince (juce::int64 start)
+        {
+            return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        }
+
+        // Loads a session's worth of instances one after the other and keeps them all alive, like a host would.
+        // Returns the time of every phase for every instance.
+        std::vector<std::array<double, numPhases>> loadSession (int numInstances, int blockSize, bool withEditor)
+        {
+            std::vector<std::unique_ptr<PunkKompProcessor>> instances;
+            std::vector<std::array<double, numPhases>> times ((size_t) numInstances);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+
+            for (auto& time : times)
+            {
+                buffer.clear();
+                auto start = juce::Time::getHighResolutionTicks();
+
+                instances.push_back (std::make_unique<PunkKompProcessor>());
+                auto& processor = *instances.back();
+                time[construct] = secondsSince (start);
+
+                start = juce::Time::getHighResolutionTicks();
+                processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+                processor.prepareToPlay (sampleRate, blockSize);
+                time[prepare] = secondsSince (start);
+
+                start = juce::Time::getHighResolutionTicks();
+                processor.processBlock (buffer, midi);
+                time[firstBlock] = secondsSince (start);
+
+                if (withEditor)
+                {
+                    // Opened and painted once, then closed again: a session keeps only a few editors open
+                    start = juce::Time::getHighResolutionTicks();
+                    std::unique_ptr<juce::AudioProcessorEditor> editor (processor.createEditorIfNeeded());
+                    editor->createComponentSnapshot (editor->getLocalBounds());
+                    time[openEditor] = secondsSince (start);
+
+                    processor.editorBeingDeleted (editor.get());
+                }
+
+                // Hosts call prepareToPlay again with the same settings, e.g. when the transport starts
+                start = juce::Time::getHighResolutionTicks();
+                processor.prepareToPlay (sampleRate, blockSize);
+                time[prepareAgain] = secondsSince (start);
+            }
+
+            return times;
+        }
+
+        void runStartup (const juce::ArgumentList& args)
+        {
+            const auto numInstances = juce::jmax (2, (int) getNumberForOption (args, "--instances", 200));
+            const auto blockSize = juce::jmax (1, (int) getNumberForOption (args, "--block", 512));
+            const auto withEditor = ! args.containsOption ("--no-editor");
+
+            const auto times = loadSession (numInstances, blockSize, withEditor);
+
+            // The first and last tenth of the session, to show whether the cost grows with the instance count
+            const auto tenth = juce::jmax (1, numInstances / 10);
+
+            const auto average = [&] (int phase, int begin, int end)
+            {
+                auto sum = 0.0;
+
+                for (auto i = begin; i < end; ++i)
+                    sum += times[(size_t) i][(size_t) phase];
+
+                return sum / (end - begin) * 1.0e6;
+            };
+
+            std::cout << numInstances << " instances, microseconds per instance\n\n"
+                      << juce::String ("phase").paddedRight (' ', 22)
+                      << juce::String ("average").paddedRight (' ', 12)
+                      << juce::String ("first 10%").paddedRight (' ', 12)
+                      << "last 10%" << std::endl;
+
+            auto total = 0.0;
+
+            for (int phase = 0; phase < numPhases; ++phase)
+            {
+                if (phase == openEditor && ! withEditor)
+                    continue;
+
+                std::cout << juce::String (phaseNames[phase]).paddedRight (' ', 22)
+                          << juce::String (average (phase, 0, numInstances), 1).paddedRight (' ', 12)
+                          << juce::String (average (phase, 0, tenth), 1).paddedRight (' ', 12)
+                          << juce::String (average (phase, numInstances - tenth, numInstances), 1) << std::endl;
+
+                total += average (phase, 0, numInstances) * numInstances;
+            }
+
+            std::cout << "\nSession load: " << juce::String (total * 1.0e-3, 1) << " ms" << std::endl;
+        }
+    }
+
+    void addStartupCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "startup",
+                          "startup [--instances=200] [--block=512] [--no-editor]",
+                          "Times what a session load costs per instance",
+                          "Creates the instances of a session one after the other and keeps them\n"
+                          "alive, timing each one's construction, prepareToPlay, first processBlock,\n"
+                          "opening (and painting) its editor, and a second prepareToPlay with the\n"
+                          "same settings. Prints the average per instance, and the first and last\n"
+                          "tenth of the session so the cost can be checked to stay flat.",
+                          [] (const juce::ArgumentList& args) { runStartup (args); } });
+    }
+}
@@ -0,0 +1,195 @@
+#include "Commands.h"
+#include "OfflineRenderer.h"
+
+#include <cstdio>
+
+#if JUCE_WINDOWS
+ #include <fcntl.h>
+ #include <io.h>
+#endif
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        using Float32 = juce::AudioData::Format<juce::AudioData::Float32, juce::AudioData::NativeEndian>;
+
+        // Raw PCM as sox and ffmpeg write it (f32le, s16le), to and from the renderer's float channels
+        template <typename DataFormat>
+        void deinterleave (const char* bytes, juce::AudioBuffer<float>& buffer, int numFrames)
+        {
+            using Source = juce::AudioData::Format<DataFormat, juce::AudioData::LittleEndian>;
+            using Element = std::remove_pointer_t<decltype (DataFormat::data)>;
+
+            juce::AudioData::deinterleaveSamples (juce::AudioData::InterleavedSource<Source> { reinterpret_cast<const Element*> (bytes), buffer.getNumChannels() },
+                                                  juce::AudioData::NonInterleavedDest<Float32> { buffer.getArrayOfWritePointers(), buffer.getNumChannels() },
+                                                  numFrames);
+        }
+
+        template <typename DataFormat>
+        void interleave (const juce::AudioBuffer<float>& buffer, char* bytes, int numFrames)
+        {
+            using Destination = juce::AudioData::Format<DataFormat, juce::AudioData::LittleEndian>;
+            using Element = std::remove_pointer_t<decltype (DataFormat::data)>;
+
+            juce::AudioData::interleaveSamples (juce::AudioData::NonInterleavedSource<Float32> { buffer.getArrayOfReadPointers(), buffer.getNumChannels() },
+                                                juce::AudioData::InterleavedDest<Destination> { reinterpret_cast<Element*> (bytes), buffer.getNumChannels() },
+                                                numFrames);
+        }
+
+        struct PcmFormat
+        {
+            const char* name;
+            int bytesPerSample;
+            void (*read) (const char*, juce::AudioBuffer<float>&, int);
+            void (*write) (const juce::AudioBuffer<float>&, char*, int);
+        };
+
+        const PcmFormat pcmFormats[] = {
+            { "f32", 4, deinterleave<juce::AudioData::Float32>, interleave<juce::AudioData::Float32> },
+            { "s16", 2, deinterleave<juce::AudioData::Int16>, interleave<juce::AudioData::Int16> },
+        };
+
+        const PcmFormat& findFormat (const juce::ArgumentList& args)
+        {
+            const auto name = args.containsOption ("--format") ? args.getValueForOption ("--format") : juce::String ("f32");
+
+            for (const auto& format : pcmFormats)
+                if (name.equalsIgnoreCase (format.name))
+                    return format;
+
+            juce::ConsoleApplication::fail ("--format must be f32 or s16");
+            return pcmFormats[0];
+        }
+
+        //==============================================================================
+        struct Report
+        {
+            juce::int64 frames = 0;
+            int chunks = 0;
+            double processSeconds = 0.0, maxChunkSeconds = 0.0;
+        };
+
+        void printReport (const Report& report, double wallSeconds, double sampleRate, int chunkFrames, int latency)
+        {
+            const auto audioSeconds = (double) report.frames / sampleRate;
+            const auto chunkMs = 1000.0 * chunkFrames / sampleRate;
+            const auto latencyMs = 1000.0 * latency / sampleRate;
+            const auto averageChunkMs = report.chunks > 0 ? 1000.0 * report.processSeconds / report.chunks : 0.0;
+
+            // stdout is the audio
+            std::cerr << juce::String (audioSeconds, 2) << " s of audio in " << report.chunks << " chunks, "
+                      << juce::String (wallSeconds, 3) << " s wall clock (" << juce::roundToInt (audioSeconds / juce::jmax (1.0e-9, wallSeconds)) << "x real time)\n"
+                      << "Processing " << juce::String (report.processSeconds, 3) << " s ("
+                      << juce::roundToInt (audioSeconds / juce::jmax (1.0e-9, report.processSeconds)) << "x real time), "
+                      << juce::String (averageChunkMs, 3) << " ms per chunk on average, " << juce::String (1000.0 * report.maxChunkSeconds, 3) << " ms at most\n"
+                      << "Latency: " << juce::String (chunkMs, 2) << " ms to fill a chunk, plus the processing, "
+                      << juce::String (chunkMs + 1000.0 * report.maxChunkSeconds, 2) << " ms at most, plus PunkKomp's own "
+                      << juce::String (latencyMs, 2) << " ms" << std::endl;
+        }
+
+        void runStream (const juce::ArgumentList& args)
+        {
+            const auto sampleRate = getNumberForOption (args, "--rate", 48000.0);
+            const auto numChannels = (int) getNumberForOption (args, "--channels", 2);
+            const auto chunkFrames = (int) getNumberForOption (args, "--chunk", 1024);
+            const auto blockSize = (int) getNumberForOption (args, "--block", 512);
+            const auto& format = findFormat (args);
+
+            if (! (sampleRate > 0.0) || chunkFrames < 1 || blockSize < 1)
+                juce::ConsoleApplication::fail ("--rate, --chunk and --block must be positive");
+
+           #if JUCE_WINDOWS
+            _setmode (_fileno (stdin), _O_BINARY);
+            _setmode (_fileno (stdout), _O_BINARY);
+           #endif
+
+            OfflineRenderer renderer (sampleRate, numChannels, blockSize);
+            renderer.setParameters (args);
+
+            // All the memory the stream needs, however long it runs
+            const auto frameBytes = (size_t) numChannels * (size_t) format.bytesPerSample;
+            juce::HeapBlock<char> bytes (frameBytes * (size_t) chunkFrames);
+            juce::AudioBuffer<float> buffer (numChannels, chunkFrames);
+
+            Report report;
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            // The renderer's latency is taken back out: that many frames are dropped from the start
+            // of the output, and that much silence after the input flushes the end out
+            const auto latency = renderer.getLatencySamples();
+            auto framesToDrop = latency;
+
+            const auto processChunk = [&] (int numFrames, bool isSilence)
+            {
+                const auto chunkStart = juce::Time::getHighResolutionTicks();
+
+                juce::AudioBuffer<float> chunk (buffer.getArrayOfWritePointers(), numChannels, numFrames);
+
+                if (isSilence)
+                    chunk.clear();
+                else
+                    format.read (bytes.get(), chunk, numFrames);
+
+                renderer.process (chunk);
+                format.write (chunk, bytes.get(), numFrames);
+
+                const auto chunkSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - chunkStart);
+                report.processSeconds += chunkSeconds;
+                report.maxChunkSeconds = juce::jmax (report.maxChunkSeconds, chunkSeconds);
+                report.frames += numFrames;
+                ++report.chunks;
+
+                const auto dropped = juce::jmin (framesToDrop, numFrames);
+                const auto numOut = (size_t) (numFrames - dropped);
+                framesToDrop -= dropped;
+
+                if (std::fwrite (bytes.get() + (size_t) dropped * frameBytes, frameBytes, numOut, stdout) != numOut)
+                    juce::ConsoleApplication::fail ("Couldn't write to stdout");
+            };
+
+            for (;;)
+            {
+                // Blocks until the chunk is full, or the input ends
+                const auto numBytes = std::fread (bytes.get(), 1, frameBytes * (size_t) chunkFrames, stdin);
+                const auto numFrames = (int) (numBytes / frameBytes);
+
+                if (numFrames > 0)
+                    processChunk (numFrames, false);
+
+                if (numBytes < frameBytes * (size_t) chunkFrames)
+                {
+                    if (std::ferror (stdin))
+                        juce::ConsoleApplication::fail ("Couldn't read from stdin");
+
+                    if (numBytes % frameBytes != 0)
+                        std::cerr << "Dropped an incomplete frame at the end of the input" << std::endl;
+
+                    break;
+                }
+            }
+
+            for (auto remaining = latency; remaining > 0; remaining -= chunkFrames)
+                processChunk (juce::jmin (remaining, chunkFrames), true);
+
+            std::fflush (stdout);
+
+            if (args.containsOption ("--report"))
+                printReport (report, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start), sampleRate, chunkFrames, latency);
+        }
+    }
+
+    void addStreamCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "stream",
+                          "stream [--rate=48000] [--channels=2] [--format=f32|s16] [--chunk=1024] [--block=512] [--report] [--comp=5 ...]",
+                          "Processes raw PCM from stdin to stdout",
+                          "Reads interleaved little endian PCM (f32le or s16le, as sox and ffmpeg write\n"
+                          "it) from stdin, --chunk frames at a time, runs each chunk through PunkKomp\n"
+                          "and writes it to stdout in the same format, so the tool can sit in a shell\n"
+                          "pipeline. Memory stays at one chunk however long the stream. Parameters are\n"
+                          "set like render's, --report prints throughput and latency to stderr.\n"
+                          "PunkKomp's own latency (LIMIT, LINEAR) is taken back out like render does.",
+                          [] (const juce::ArgumentList& args) { runStream (args); } });
+    }
+}
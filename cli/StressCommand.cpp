@@ -0,0 +1,224 @@
+#include "Commands.h"
+#include "OfflineRenderer.h"
+#include "TestSignals.h"
+
+#include <thread>
+
+namespace PunkKompCLI
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+
+        struct StressOptions
+        {
+            double seconds = 10.0;
+            int numChannels = 2;
+            int blockSize = 256;
+        };
+
+        struct Counters
+        {
+            std::atomic<bool> running { true };
+            std::atomic<bool> badOutput { false };
+            std::atomic<juce::int64> blocks { 0 }, parameterChanges { 0 }, stateSaves { 0 }, stateLoads { 0 };
+            std::atomic<juce::int64> editorsOpened { 0 }, meterPolls { 0 };
+        };
+
+        //==============================================================================
+        // The host's audio thread: the drum loop in fixed blocks, as fast as it goes
+        void audioThread (OfflineRenderer& renderer, Counters& counters, int numChannels, int blockSize)
+        {
+            const auto input = TestSignals::make ("drums", sampleRate, numChannels, 2.0);
+            juce::AudioBuffer<float> buffer (numChannels, blockSize);
+
+            for (int start = 0; counters.running; start = (start + blockSize) % (input.getNumSamples() - blockSize))
+            {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    buffer.copyFrom (ch, 0, input, ch, start, blockSize);
+
+                renderer.process (buffer);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    if (! std::isfinite (buffer.getMagnitude (ch, 0, blockSize)))
+                        counters.badOutput = true;
+
+                ++counters.blocks;
+            }
+        }
+
+        // Host automation: random parameters to random values, in gestures. Every other change is to
+        // LINEAR or VOICE, so the linear phase voice is built, switched and faded in and out between
+        // the audio and message threads all the time rather than once in a while
+        void automationThread (PunkKompProcessor& processor, Counters& counters)
+        {
+            juce::Random random (1);
+            const auto& parameters = processor.getParameters();
+            juce::AudioProcessorParameter* voiceParameters[] = { processor.state.getParameter ("LINEAR"), processor.state.getParameter ("VOICE") };
+
+            while (counters.running)
+            {
+                auto* parameter = random.nextBool() ? voiceParameters[random.nextInt ((int) std::size (voiceParameters))]
+                                                    : parameters[random.nextInt (parameters.size())];
+
+                parameter->beginChangeGesture();
+                parameter->setValueNotifyingHost (random.nextFloat());
+                parameter->endChangeGesture();
+
+                ++counters.parameterChanges;
+                std::this_thread::sleep_for (std::chrono::microseconds (random.nextInt (200)));
+            }
+        }
+
+        // Host saving and restoring the plugin state, which some hosts do off the message thread
+        void stateThread (PunkKompProcessor& processor, Counters& counters)
+        {
+            juce::Random random (2);
+            juce::MemoryBlock saved;
+            processor.getStateInformation (saved);
+
+            while (counters.running)
+            {
+                if (random.nextInt (4) == 0)
+                {
+                    processor.setStateInformation (saved.getData(), (int) saved.getSize());
+                    ++counters.stateLoads;
+                }
+                else
+                {
+                    saved.reset();
+                    processor.getStateInformation (saved);
+                    ++counters.stateSaves;
+                }
+
+                std::this_thread::sleep_for (std::chrono::milliseconds (random.nextInt (3)));
+            }
+        }
+
+        //==============================================================================
+        // The message thread: opens and closes the editor while its timers poll the
+        // meter and history, and stops the dispatch loop when the time is up
+        class MessageThreadStress : private juce::Timer
+        {
+        public:
+            MessageThreadStress (PunkKompProcessor& p, Counters& c, double seconds)
+                : processor (p), counters (c),
+                  endTime (juce::Time::getMillisecondCounterHiRes() + seconds * 1000.0)
+            {
+                startTimer (5);
+            }
+
+            ~MessageThreadStress() override
+            {
+                stopTimer();
+                closeEditor();
+            }
+
+        private:
+            void timerCallback() override
+            {
+                if (juce::Time::getMillisecondCounterHiRes() >= endTime)
+                {
+                    stopTimer();
+                    juce::MessageManager::getInstance()->stopDispatchLoop();
+                    return;
+                }
+
+                if (! std::isfinite (processor.getGRValue()))
+                    counters.badOutput = true;
+
+                ++counters.meterPolls;
+
+                if (random.nextInt (20) == 0)
+                {
+                    if (editor == nullptr)
+                    {
+                        editor.reset (processor.createEditorIfNeeded());
+                        ++counters.editorsOpened;
+                    }
+                    else
+                    {
+                        closeEditor();
+                    }
+                }
+            }
+
+            void closeEditor()
+            {
+                if (editor != nullptr)
+                {
+                    processor.editorBeingDeleted (editor.get());
+                    editor.reset();
+                }
+            }
+
+            PunkKompProcessor& processor;
+            Counters& counters;
+            const double endTime;
+            juce::Random random { 3 };
+            std::unique_ptr<juce::AudioProcessorEditor> editor;
+        };
+
+        //==============================================================================
+        void runStress (const StressOptions& options)
+        {
+            OfflineRenderer renderer (sampleRate, options.numChannels, options.blockSize);
+            auto& processor = renderer.getProcessor();
+            Counters counters;
+
+            // The renderer runs offline, where the processor does everything on the audio thread.
+            // A real time host is the one with work handed to the message thread, which is the point here.
+            processor.setNonRealtime (false);
+
+            std::cout << "Running for " << options.seconds << " s..." << std::endl;
+
+            {
+                MessageThreadStress messageThread (processor, counters, options.seconds);
+
+                std::thread audio ([&] { audioThread (renderer, counters, options.numChannels, options.blockSize); });
+                std::thread automation ([&] { automationThread (processor, counters); });
+                std::thread stateChanges ([&] { stateThread (processor, counters); });
+
+                juce::MessageManager::getInstance()->runDispatchLoop();
+
+                counters.running = false;
+                audio.join();
+                automation.join();
+                stateChanges.join();
+            }
+
+            std::cout << counters.blocks << " blocks, "
+                      << counters.parameterChanges << " parameter changes, "
+                      << counters.stateSaves << " state saves, "
+                      << counters.stateLoads << " state loads, "
+                      << counters.editorsOpened << " editors opened, "
+                      << counters.meterPolls << " meter polls" << std::endl;
+
+            if (counters.badOutput)
+                juce::ConsoleApplication::fail ("The output or the meter went non-finite");
+        }
+    }
+
+    void addStressCommand (juce::ConsoleApplication& app)
+    {
+        app.addCommand ({ "stress",
+                          "stress [--seconds=10] [--channels=2] [--block=256]",
+                          "Hammers one instance from the audio, automation, state and message threads at once",
+                          "Runs processBlock in real time mode in a loop while other threads set random\n"
+                          "parameters (half the time LINEAR or VOICE) and save and restore the state,\n"
+                          "and the message thread opens and closes the editor, polls the meter and\n"
+                          "builds and switches the linear phase voice. Only fails by itself on\n"
+                          "non-finite output; the point is to run it in a build configured with\n"
+                          "-DPUNKKOMP_ENABLE_TSAN=ON, where ThreadSanitizer reports any data race\n"
+                          "between those threads.",
+                          [] (const juce::ArgumentList& args)
+                          {
+                              StressOptions options;
+                              options.seconds = getNumberForOption (args, "--seconds", options.seconds);
+                              options.numChannels = (int) getNumberForOption (args, "--channels", options.numChannels);
+                              options.blockSize = juce::jmax (1, (int) getNumberForOption (args, "--block", options.blockSize));
+
+                              runStress (options);
+                          } });
+    }
+}
@@ -0,0 +1,113 @@
+#include "TestSignals.h"
+
+namespace PunkKompCLI::TestSignals
+{
+    namespace
+    {
+        constexpr auto twoPi = juce::MathConstants<double>::twoPi;
+
+        // 1 kHz at -6 dBFS, 200 ms on and 200 ms off with 5 ms fades
+        void sineBursts (float* out, int numSamples, double sampleRate)
+        {
+            const auto period = (int) (0.4 * sampleRate);
+            const auto on = period / 2;
+            const auto fade = (int) (0.005 * sampleRate);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto position = i % period;
+                const auto envelope = position >= on ? 0.0f
+                                                     : (float) juce::jmin (1.0, position / (double) fade, (on - position) / (double) fade);
+
+                out[i] = 0.5f * envelope * (float) std::sin (twoPi * 1000.0 * i / sampleRate);
+            }
+        }
+
+        // Karplus-Strong plucks walking up an E minor arpeggio, two per second
+        void plucks (float* out, int numSamples, double sampleRate, juce::Random& random)
+        {
+            const double notes[] = { 82.41, 123.47, 164.81, 196.0, 246.94, 329.63 };
+            const auto noteLength = (int) (0.5 * sampleRate);
+
+            std::vector<float> line;
+
+            for (int start = 0, note = 0; start < numSamples; start += noteLength, ++note)
+            {
+                line.resize ((size_t) juce::roundToInt (sampleRate / notes[note % 6]));
+
+                for (auto& s : line)
+                    s = 0.8f * (random.nextFloat() * 2.0f - 1.0f);
+
+                size_t index = 0;
+
+                for (int i = start; i < juce::jmin (numSamples, start + noteLength); ++i)
+                {
+                    const auto next = (index + 1) % line.size();
+                    out[i] = line[index];
+                    line[index] = 0.498f * (line[index] + line[next]);
+                    index = next;
+                }
+            }
+        }
+
+        // Kick on the beats, snare on 2 and 4, closed hats on the eighths, 120 bpm
+        void drums (float* out, int numSamples, double sampleRate, juce::Random& random)
+        {
+            const auto eighth = (int) (0.25 * sampleRate);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto step = i / eighth;
+                const auto t = (i % eighth) / sampleRate;
+                auto sample = 0.0;
+
+                if (step % 2 == 0)
+                    sample += 0.9 * std::exp (-t * 18.0) * std::sin (twoPi * (50.0 * t + 60.0 * (1.0 - std::exp (-t * 30.0)) / 30.0));
+
+                if (step % 4 == 2)
+                    sample += 0.5 * std::exp (-t * 25.0) * (random.nextDouble() * 2.0 - 1.0);
+
+                sample += 0.15 * std::exp (-t * 120.0) * (random.nextDouble() * 2.0 - 1.0);
+
+                out[i] = (float) sample;
+            }
+        }
+
+        // Full scale clicks every 250 ms
+        void impulses (float* out, int numSamples, double sampleRate)
+        {
+            const auto period = (int) (0.25 * sampleRate);
+
+            for (int i = 0; i < numSamples; ++i)
+                out[i] = i % period == 0 ? 1.0f : 0.0f;
+        }
+    }
+
+    juce::StringArray getNames()
+    {
+        return { "sine_bursts", "plucks", "drums", "silence", "dc", "impulses" };
+    }
+
+    juce::AudioBuffer<float> make (const juce::String& name, double sampleRate, int numChannels, double seconds)
+    {
+        const auto numSamples = (int) (seconds * sampleRate);
+        juce::AudioBuffer<float> buffer (numChannels, numSamples);
+        buffer.clear();
+
+        // Every channel gets its own take of the random signals, but always the same one
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            juce::Random random (0x5eed + ch);
+            auto* out = buffer.getWritePointer (ch);
+
+            if (name == "sine_bursts")    sineBursts (out, numSamples, sampleRate);
+            else if (name == "plucks")    plucks (out, numSamples, sampleRate, random);
+            else if (name == "drums")     drums (out, numSamples, sampleRate, random);
+            else if (name == "dc")        juce::FloatVectorOperations::fill (out, 0.5f, numSamples);
+            else if (name == "impulses")  impulses (out, numSamples, sampleRate);
+            else if (name != "silence")   jassertfalse;
+        }
+
+        return buffer;
+    }
+}
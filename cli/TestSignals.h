@@ -0,0 +1,19 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace PunkKompCLI
+{
+    /**
+        Short signals generated in code, so renders of them are reproducible on
+        any machine without shipping audio files: sine bursts, plucked strings
+        (a stand-in for guitar DI), a drum loop, silence, DC and impulses.
+    */
+    namespace TestSignals
+    {
+        juce::StringArray getNames();
+
+        /** Always the same samples for the same arguments. */
+        juce::AudioBuffer<float> make (const juce::String& name, double sampleRate, int numChannels, double seconds);
+    }
+}
@@ -0,0 +1,317 @@
+#include "punkkomp.h"
+
+#include "KompParameters.h"
+
+namespace
+{
+    struct ParameterInfo
+    {
+        const char* id;
+        juce::NormalisableRange<float> range;
+        float defaultValue;
+    };
+
+    // The same IDs, ranges and steps as PunkKompProcessor::createParams
+    const ParameterInfo parameterInfos[] = {
+        { "ONOFF",    { 0.0f, 1.0f, 1.0f }, 1.0f },
+        { "COMP",     { 0.0f, 10.0f, 0.1f }, DEFAULT_COMP },
+        { "LEVEL",    { -18.0f, 18.0f, 0.1f }, DEFAULT_OUTPUT },
+        { "ATTACK",   { 1.0f, 100.0f, 0.1f }, DEFAULT_ATTACK },
+        { "MIX",      { 10.0f, 100.0f, 0.1f }, DEFAULT_MIX },
+        { "VOICE",    { 0.0f, 2.0f, 1.0f }, (float) DEFAULT_VOICE },
+        { "LINK",     { 0.0f, 1.0f, 1.0f }, 0.0f },
+        { "BANDS",    { 1.0f, 3.0f, 1.0f }, (float) DEFAULT_BANDS },
+        { "XLOW",     { 40.0f, 800.0f, 1.0f, 0.5f }, DEFAULT_XLOW },
+        { "XHIGH",    { 1000.0f, 8000.0f, 1.0f, 0.5f }, DEFAULT_XHIGH },
+        { "COMPLOW",  { -5.0f, 5.0f, 0.1f }, 0.0f },
+        { "COMPMID",  { -5.0f, 5.0f, 0.1f }, 0.0f },
+        { "COMPHIGH", { -5.0f, 5.0f, 0.1f }, 0.0f },
+        { "GATE",     { KompParameters::gateOffDecibels, -20.0f, 0.1f }, DEFAULT_GATE },
+        { "LIMIT",    { 0.0f, 1.0f, 1.0f }, 0.0f },
+        { "VMODE",    { 0.0f, 1.0f, 1.0f }, 0.0f },
+        { "MORPH",    { 0.0f, VoiceMorphTable::maxPosition }, DEFAULT_MORPH },
+        { "LINEAR",   { 0.0f, 1.0f, 1.0f }, 0.0f },
+    };
+
+    static_assert (std::size (parameterInfos) == PUNKKOMP_NUM_PARAMETERS);
+
+    bool isValid (punkkomp_parameter parameter) noexcept
+    {
+        return juce::isPositiveAndBelow ((int) parameter, (int) PUNKKOMP_NUM_PARAMETERS);
+    }
+}
+
+//==============================================================================
+/*
+    One PunkKomp without the plugin around it: the engine, driven through
+    KompParameters exactly like PunkKompProcessor drives its own.
+*/
+struct punkkomp
+{
+    punkkomp()
+    {
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = parameterInfos[i].defaultValue;
+    }
+
+    float get (punkkomp_parameter parameter) const noexcept     { return values[(size_t) parameter]; }
+
+    // The same steps as PunkKompProcessor::updateState, which runs at the start of each of its sub-blocks
+    void updateEngine()
+    {
+        on = get (PUNKKOMP_ONOFF) > 0.5f;
+
+        engine.setInputGainDecibels (KompParameters::getInputGainDecibels (get (PUNKKOMP_COMP)));
+        engine.setThreshold (KompParameters::getThresholdDecibels (get (PUNKKOMP_COMP)));
+        KompParameters::setGate (engine, get (PUNKKOMP_GATE));
+        engine.setAttack (get (PUNKKOMP_ATTACK));
+        engine.setMix (KompParameters::getWetProportion (get (PUNKKOMP_MIX)));
+
+        const auto voice = (int) get (PUNKKOMP_VOICE);
+
+        if (voice != currentVoice && voices != nullptr)
+        {
+            currentVoice = voice;
+            engine.setPeakCoefficients (voices->peak[(size_t) voice]);
+            engine.setLinearPhaseVoice (voice);
+        }
+
+        engine.setVoiceMorphEnabled (get (PUNKKOMP_VMODE) > 0.5f);
+        engine.setVoiceMorphPosition (get (PUNKKOMP_MORPH));
+
+        engine.setLinked (get (PUNKKOMP_LINK) > 0.5f);
+
+        const auto numBands = (int) get (PUNKKOMP_BANDS);
+        engine.setNumBands (numBands);
+        engine.setCrossoverFrequencies (get (PUNKKOMP_XLOW), get (PUNKKOMP_XHIGH));
+
+        for (int band = 0; band < KompEngine::maxBands; ++band)
+        {
+            const auto offset = (punkkomp_parameter) (PUNKKOMP_COMPLOW + KompParameters::getBandOffsetIndex (numBands, band));
+            KompParameters::setBandOffset (engine, band, get (offset));
+        }
+
+        engine.setOutputGainDecibels (get (PUNKKOMP_LEVEL));
+    }
+
+    void prepare (double sampleRate, int channels, int blockSize)
+    {
+        numChannels = channels;
+        maxBlockSize = blockSize;
+
+        engine.prepare ({ sampleRate, (juce::uint32) maxBlockSize, (juce::uint32) numChannels });
+
+        voices = &resources->getVoiceCoefficients (sampleRate);
+        KompParameters::setFixedParameters (engine, *voices, resources->getVoiceMorph (sampleRate));
+        updateLatencyModes();
+
+        // Start from the current values instead of ramping to them
+        currentVoice = -1;
+        updateEngine();
+        engine.reset();
+
+        // For the interleaved calls, one block of each channel
+        deinterleaved.setSize (numChannels, maxBlockSize);
+    }
+
+    // Out here rather than in updateEngine, as building the linear phase voice allocates, and
+    // punkkomp_get_latency has the latency of both as soon as they're set
+    void updateLatencyModes()
+    {
+        const auto linear = get (PUNKKOMP_LINEAR) > 0.5f;
+
+        if (maxBlockSize > 0 && linear)
+            engine.prepareLinearPhaseVoice();
+
+        engine.setLinearPhaseVoiceEnabled (linear);
+        engine.setLimiterEnabled (get (PUNKKOMP_LIMIT) > 0.5f);
+    }
+
+    void process (float* const* channels, int numSamples) noexcept
+    {
+        updateEngine();
+
+        const juce::dsp::AudioBlock<float> block (channels, (size_t) numChannels, (size_t) numSamples);
+
+        if (on)
+            engine.process (block);
+        else
+            engine.processBypassed (block);
+    }
+
+    void processInterleaved (float* samples, int numFrames) noexcept
+    {
+        updateEngine();
+
+        const auto stride = (size_t) numChannels;
+
+        for (int start = 0; start < numFrames; start += maxBlockSize)
+        {
+            const auto length = juce::jmin (maxBlockSize, numFrames - start);
+            auto* frames = samples + (size_t) start * stride;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto* channel = deinterleaved.getWritePointer (ch);
+
+                for (int i = 0; i < length; ++i)
+                    channel[i] = frames[(size_t) i * stride + (size_t) ch];
+            }
+
+            const auto block = juce::dsp::AudioBlock<float> (deinterleaved).getSubBlock (0, (size_t) length);
+
+            if (on)
+                engine.process (block);
+            else
+                engine.processBypassed (block);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const auto* channel = deinterleaved.getReadPointer (ch);
+
+                for (int i = 0; i < length; ++i)
+                    frames[(size_t) i * stride + (size_t) ch] = channel[i];
+            }
+        }
+    }
+
+    KompEngine engine;
+    juce::SharedResourcePointer<DspResources> resources;
+    const VoiceCoefficients* voices = nullptr;
+
+    std::array<float, PUNKKOMP_NUM_PARAMETERS> values;
+    int currentVoice = -1;
+    bool on = true;
+
+    int numChannels = 0, maxBlockSize = 0;
+    juce::AudioBuffer<float> deinterleaved;
+};
+
+//==============================================================================
+punkkomp* punkkomp_create (void)
+{
+    try
+    {
+        return new punkkomp();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void punkkomp_destroy (punkkomp* instance)
+{
+    delete instance;
+}
+
+punkkomp_status punkkomp_prepare (punkkomp* instance, double sample_rate, int num_channels, int max_block_size)
+{
+    if (instance == nullptr || ! (sample_rate > 0.0) || max_block_size <= 0
+        || ! juce::isPositiveAndNotGreaterThan (num_channels, KompEngine::maxChannels))
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    try
+    {
+        instance->prepare (sample_rate, num_channels, max_block_size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        instance->maxBlockSize = 0;
+        return PUNKKOMP_OUT_OF_MEMORY;
+    }
+
+    return PUNKKOMP_OK;
+}
+
+punkkomp_status punkkomp_reset (punkkomp* instance)
+{
+    if (instance == nullptr)
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    if (instance->maxBlockSize == 0)
+        return PUNKKOMP_NOT_PREPARED;
+
+    instance->engine.reset();
+    return PUNKKOMP_OK;
+}
+
+punkkomp_status punkkomp_set_parameter (punkkomp* instance, punkkomp_parameter parameter, float value)
+{
+    if (instance == nullptr || ! isValid (parameter) || std::isnan (value))
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    // Through the normalised value and snapped, the way the plugin's parameters take a host's value,
+    // so it lands on the very same float
+    const auto& range = parameterInfos[parameter].range;
+    instance->values[(size_t) parameter] = range.snapToLegalValue (range.convertFrom0to1 (range.convertTo0to1 (value)));
+
+    if (parameter == PUNKKOMP_LINEAR || parameter == PUNKKOMP_LIMIT)
+    {
+        try
+        {
+            instance->updateLatencyModes();
+        }
+        catch (const std::bad_alloc&)
+        {
+            return PUNKKOMP_OUT_OF_MEMORY;
+        }
+    }
+
+    return PUNKKOMP_OK;
+}
+
+float punkkomp_get_parameter (const punkkomp* instance, punkkomp_parameter parameter)
+{
+    return instance != nullptr && isValid (parameter) ? instance->get (parameter) : 0.0f;
+}
+
+const char* punkkomp_get_parameter_id (punkkomp_parameter parameter)
+{
+    return isValid (parameter) ? parameterInfos[parameter].id : nullptr;
+}
+
+punkkomp_parameter punkkomp_find_parameter (const char* id)
+{
+    if (id != nullptr)
+        for (int i = 0; i < PUNKKOMP_NUM_PARAMETERS; ++i)
+            if (juce::String (parameterInfos[i].id).equalsIgnoreCase (id))
+                return (punkkomp_parameter) i;
+
+    return PUNKKOMP_NUM_PARAMETERS;
+}
+
+int punkkomp_get_latency (const punkkomp* instance)
+{
+    return instance != nullptr ? instance->engine.getLatencySamples() : 0;
+}
+
+punkkomp_status punkkomp_process (punkkomp* instance, float* const* channels, int num_channels, int num_samples)
+{
+    if (instance == nullptr || channels == nullptr || num_samples < 0)
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    if (instance->maxBlockSize == 0)
+        return PUNKKOMP_NOT_PREPARED;
+
+    if (num_channels != instance->numChannels)
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    instance->process (channels, num_samples);
+    return PUNKKOMP_OK;
+}
+
+punkkomp_status punkkomp_process_interleaved (punkkomp* instance, float* samples, int num_channels, int num_frames)
+{
+    if (instance == nullptr || samples == nullptr || num_frames < 0)
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    if (instance->maxBlockSize == 0)
+        return PUNKKOMP_NOT_PREPARED;
+
+    if (num_channels != instance->numChannels)
+        return PUNKKOMP_INVALID_ARGUMENT;
+
+    instance->processInterleaved (samples, num_frames);
+    return PUNKKOMP_OK;
+}
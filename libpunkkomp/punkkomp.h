@@ -0,0 +1,108 @@
+#ifndef PUNKKOMP_H
+#define PUNKKOMP_H
+
+/*
+    libpunkkomp: the PunkKomp DSP behind a plain C API, for batch processing and
+    test rigs that want the plugin's exact sound without hosting a plugin.
+
+    No message loop, editor or JUCE initialisation is needed. Audio is processed
+    in place in the caller's buffers, planar or interleaved 32 bit float.
+
+    An instance may be used from any thread, but from one thread at a time.
+    Only the process calls are real time safe: they never allocate or lock.
+    Different instances are independent.
+*/
+
+#if defined (_WIN32)
+ #if defined (PUNKKOMP_BUILDING_LIBRARY)
+  #define PUNKKOMP_API __declspec (dllexport)
+ #else
+  #define PUNKKOMP_API __declspec (dllimport)
+ #endif
+#else
+ #define PUNKKOMP_API __attribute__ ((visibility ("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct punkkomp punkkomp;
+
+typedef enum punkkomp_status
+{
+    PUNKKOMP_OK = 0,
+    PUNKKOMP_INVALID_ARGUMENT = -1,     /* null pointer, unknown parameter, or a channel count or size out of range */
+    PUNKKOMP_NOT_PREPARED = -2,         /* process called before punkkomp_prepare */
+    PUNKKOMP_OUT_OF_MEMORY = -3
+} punkkomp_status;
+
+/* The plugin's parameters, set in the same plain units as its knobs */
+typedef enum punkkomp_parameter
+{
+    PUNKKOMP_ONOFF,         /* 0 or 1 */
+    PUNKKOMP_COMP,          /* 0 to 10 */
+    PUNKKOMP_LEVEL,         /* output level, -18 to 18 dB */
+    PUNKKOMP_ATTACK,        /* 1 to 100 ms */
+    PUNKKOMP_MIX,           /* 10 to 100 % */
+    PUNKKOMP_VOICE,         /* 0, 1 or 2 */
+    PUNKKOMP_LINK,          /* linked detector, 0 or 1 */
+    PUNKKOMP_BANDS,         /* 1, 2 or 3 */
+    PUNKKOMP_XLOW,          /* low crossover, 40 to 800 Hz */
+    PUNKKOMP_XHIGH,         /* high crossover, 1000 to 8000 Hz */
+    PUNKKOMP_COMPLOW,       /* band compression offsets, -5 to 5 */
+    PUNKKOMP_COMPMID,
+    PUNKKOMP_COMPHIGH,
+    PUNKKOMP_GATE,          /* gate threshold, -80 (off) to -20 dB */
+    PUNKKOMP_LIMIT,         /* safety limiter at -0.3 dBFS, 0 or 1. Adds its lookahead to the latency. */
+    PUNKKOMP_VMODE,         /* voice morph instead of the voice switch, 0 or 1 */
+    PUNKKOMP_MORPH,         /* voice morph position, 0 (left voice) to 2 (right voice) */
+    PUNKKOMP_LINEAR,        /* the VOICE's filter curve in linear phase, ahead of the morph, 0 or 1. Adds latency. */
+    PUNKKOMP_NUM_PARAMETERS
+} punkkomp_parameter;
+
+/* Maximum channels per instance */
+#define PUNKKOMP_MAX_CHANNELS 16
+
+/* Returns null if out of memory. Parameters start at the plugin's defaults. */
+PUNKKOMP_API punkkomp* punkkomp_create (void);
+PUNKKOMP_API void punkkomp_destroy (punkkomp* instance);
+
+/* Allocates everything processing needs and clears the state. Call again to change any of the
+   settings, or with the same ones to clear the state. Not real time safe. */
+PUNKKOMP_API punkkomp_status punkkomp_prepare (punkkomp* instance, double sample_rate, int num_channels, int max_block_size);
+
+/* Clears the filter and detector state, as if the audio had stopped */
+PUNKKOMP_API punkkomp_status punkkomp_reset (punkkomp* instance);
+
+/* Values snap to the plugin's steps and range, like host automation does. Changes ramp in
+   over the next samples processed, the way they do in the plugin. Switching PUNKKOMP_LINEAR on for
+   the first time allocates here rather than in the process calls, which isn't real time safe. */
+PUNKKOMP_API punkkomp_status punkkomp_set_parameter (punkkomp* instance, punkkomp_parameter parameter, float value);
+PUNKKOMP_API float punkkomp_get_parameter (const punkkomp* instance, punkkomp_parameter parameter);
+
+/* The plugin's parameter ID ("COMP", "XLOW"...), or null */
+PUNKKOMP_API const char* punkkomp_get_parameter_id (punkkomp_parameter parameter);
+
+/* The parameter with that ID, case insensitive, or PUNKKOMP_NUM_PARAMETERS */
+PUNKKOMP_API punkkomp_parameter punkkomp_find_parameter (const char* id);
+
+/* How many samples late the output comes out: the safety limiter's lookahead while PUNKKOMP_LIMIT is
+   on, plus the linear phase voice's delay while PUNKKOMP_LINEAR is. It follows either as soon as it's
+   set, and the output crossfades over to it in the 50 ms after that many samples. */
+PUNKKOMP_API int punkkomp_get_latency (const punkkomp* instance);
+
+/* Processes num_channels separate buffers of num_samples in place. Any number of samples,
+   blocks longer than max_block_size are processed in pieces. num_channels must be the
+   prepared count. */
+PUNKKOMP_API punkkomp_status punkkomp_process (punkkomp* instance, float* const* channels, int num_channels, int num_samples);
+
+/* The same on one buffer of num_frames interleaved frames. The engine works on separate channels,
+   so each max_block_size piece is deinterleaved into the instance's own buffer and back. */
+PUNKKOMP_API punkkomp_status punkkomp_process_interleaved (punkkomp* instance, float* samples, int num_channels, int num_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "KompKernel.h"
+
+//==============================================================================
+/**
+    Multiband front end of the PunkKomp chain. Each channel is split by up to
+    two Linkwitz-Riley crossovers and every band gets its own detector and gain
+    curve. The bands of one channel live side by side in the lanes of a
+    BandVector (low, mid, high), so the crossovers, the envelopes and the gain
+    stage run once per channel whatever the number of bands.
+
+    A 3 band split runs both crossover stages on every lane with different
+    output weights:
+
+        stage 1 (low cutoff):   lanes {x, x, x}        -> {low, high, high}
+        stage 2 (high cutoff):  lanes {low, high, high} -> {allpass, low, high}
+
+    The allpass on the low band keeps the three bands in phase, so they sum
+    back flat.
+*/
+using BandVector = LaneOps::BandVector;
+
+struct BandCrossover
+{
+    // Same maths as juce::dsp::LinkwitzRileyFilter, with a cutoff and output weights per lane
+    BandVector g { 0.0f }, h { 1.0f }, r2PlusG { 0.0f };
+    BandVector lowWeight { 0.0f }, highWeight { 0.0f };
+};
+
+struct BandCoefficients
+{
+    BandCrossover crossovers[2];
+    int numStages = 1;
+    int numBands = 1;
+
+    BandVector thresholdOffset { 1.0f };   // per band factor on the threshold ramp (inverse)
+    BandVector gain { 0.0f };              // per band input gain, unused lanes stay silent
+    float gainSmoothing = 0.0f;            // one pole coefficient for gain changes
+    float release = 0.0f;
+    const GainCurveTable* gainCurve = nullptr;
+    const GainCurveTable* gateCurve = nullptr;    // nullptr while the gate is off
+};
+
+struct BandState
+{
+    BandVector crossovers[2][4] {};
+    BandVector envelope {};
+
+    void reset() noexcept { *this = {}; }
+};
+
+//==============================================================================
+inline BandVector processCrossover (BandVector input, const BandCrossover& c, BandVector* s) noexcept
+{
+    const BandVector r2 (static_cast<float> (std::sqrt (2.0)));
+
+    const auto yH = (input - c.r2PlusG * s[0] - s[1]) * c.h;
+
+    const auto yB = c.g * yH + s[0];
+    s[0] = c.g * yH + yB;
+
+    const auto yL = c.g * yB + s[1];
+    s[1] = c.g * yB + yL;
+
+    const auto yH2 = (yL - c.r2PlusG * s[2] - s[3]) * c.h;
+
+    const auto yB2 = c.g * yH2 + s[2];
+    s[2] = c.g * yH2 + yB2;
+
+    const auto yL2 = c.g * yB2 + s[3];
+    s[3] = c.g * yB2 + yL2;
+
+    const auto high = yL - r2 * yB + yH - yL2;
+    return yL2 * c.lowWeight + high * c.highWeight;
+}
+
+/**
+    Splits, compresses and sums the bands of every channel. The output is the
+    compressed signal after the input gain, ready to be mixed with the dry one.
+    bands is scratch space for numChannels vectors.
+*/
+template <bool Linked>
+void processBands (const float* const* input, float* const* output, int numChannels, int numSamples,
+                   BandState* states, BandVector& linkedEnvelope, BandVector& bandGain, BandVector* bands,
+                   const BandCoefficients& c, const KompRamps& ramps) noexcept
+{
+    const BandVector release (c.release);
+    const auto& curve = *c.gainCurve;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        bandGain = c.gain + BandVector (c.gainSmoothing) * (bandGain - c.gain);
+
+        const BandVector attack (ramps.attack[i]);
+        const auto thresholdInverse = c.thresholdOffset * BandVector (ramps.thresholdInverse[i]);
+
+        // The bands' envelopes include their gain offsets, the gate threshold follows them
+        const auto gateThreshold = c.gateCurve != nullptr ? bandGain * BandVector (ramps.gateThreshold[i]) : BandVector {};
+
+        BandVector peak {};
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto& s = states[ch];
+            auto b = processCrossover (BandVector (input[ch][i] * ramps.input[i]), c.crossovers[0], s.crossovers[0]);
+
+            if (c.numStages > 1)
+                b = processCrossover (b, c.crossovers[1], s.crossovers[1]);
+
+            bands[ch] = b * bandGain;
+
+            if constexpr (Linked)
+                peak = LaneOps::max (peak, LaneOps::abs (bands[ch]));
+        }
+
+        BandVector gain;
+
+        if constexpr (Linked)
+        {
+            linkedEnvelope = peak + LaneOps::selectGreater (peak, linkedEnvelope, attack, release) * (linkedEnvelope - peak);
+            gain = LaneOps::compressorGain (linkedEnvelope, thresholdInverse, curve, c.numBands);
+
+            if (c.gateCurve != nullptr)
+                gain = gain * LaneOps::expanderGain (linkedEnvelope, gateThreshold, *c.gateCurve, c.numBands);
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if constexpr (! Linked)
+            {
+                auto& envelope = states[ch].envelope;
+                const auto level = LaneOps::abs (bands[ch]);
+                envelope = level + LaneOps::selectGreater (level, envelope, attack, release) * (envelope - level);
+                gain = LaneOps::compressorGain (envelope, thresholdInverse, curve, c.numBands);
+
+                if (c.gateCurve != nullptr)
+                    gain = gain * LaneOps::expanderGain (envelope, gateThreshold, *c.gateCurve, c.numBands);
+            }
+
+            output[ch][i] = LaneOps::horizontalSum (bands[ch] * gain);
+        }
+    }
+}
@@ -0,0 +1,237 @@
+#include "DspResources.h"
+#include "KompKernel.h"
+
+namespace
+{
+    // The voices' peak filters: centre frequency, Q and gain
+    struct VoiceDesign
+    {
+        float frequency, q, gain;
+    };
+
+    constexpr VoiceDesign voiceDesigns[VoiceCoefficients::numVoices] = {
+        { 2430.f, 0.5f, 2.0f },
+        { 2430.f, 0.5f, 1.f },
+        { 2000.f, 0.35f, 2.5f },
+    };
+
+    std::array<float, 6> makeVoicePeak (double sampleRate, const VoiceDesign& design)
+    {
+        return juce::dsp::IIR::ArrayCoefficients<float>::makePeakFilter (sampleRate, design.frequency, design.q, design.gain);
+    }
+
+    // H of a {b0, b1, b2, a0, a1, a2} biquad at an angular frequency in radians per sample
+    std::complex<double> getResponse (const std::array<float, 6>& c, double omega)
+    {
+        const auto z = std::polar (1.0, -omega);
+        return ((double) c[0] + ((double) c[1] + (double) c[2] * z) * z) / ((double) c[3] + ((double) c[4] + (double) c[5] * z) * z);
+    }
+}
+
+//==============================================================================
+BallisticsTable::BallisticsTable (double rate) : sampleRate (rate)
+{
+    for (int i = 0; i < numSteps; ++i)
+        coefficients[(size_t) i] = calculate (sampleRate, getStepTime (i));
+}
+
+float BallisticsTable::calculate (double sampleRate, float timeMs)
+{
+    const auto expFactor = -2.0 * juce::MathConstants<double>::pi * 1000.0 / sampleRate;
+    return timeMs < 1.0e-3f ? 0.0f : static_cast<float> (std::exp (expFactor / timeMs));
+}
+
+//==============================================================================
+VoiceMorphTable::VoiceMorphTable (double sampleRate)
+{
+    for (int i = 0; i < numSteps; ++i)
+    {
+        const auto voice = i / stepsPerVoice;
+        const auto& from = voiceDesigns[voice];
+        auto design = from;
+
+        // Off the voices, each of the three moves by the same ratio per step
+        if (const auto fraction = (double) (i % stepsPerVoice) / stepsPerVoice; fraction > 0.0)
+        {
+            const auto& to = voiceDesigns[voice + 1];
+            const auto between = [fraction] (float a, float b) { return static_cast<float> (a * std::pow ((double) b / a, fraction)); };
+
+            design = { between (from.frequency, to.frequency), between (from.q, to.q), between (from.gain, to.gain) };
+        }
+
+        const auto peak = makeVoicePeak (sampleRate, design);
+        auto& step = steps[(size_t) i];
+        normaliseBiquad (peak, step.data());
+
+        // Dividing by a0 can leave b0 a bit off 1, and the switch runs a flat voice as no filter at all
+        if (isIdentityBiquad (peak))
+            step = { 1.0f, step[3], step[4], step[3], step[4] };
+    }
+
+    jassert (isStable());
+}
+
+void VoiceMorphTable::getCoefficients (float position, float* destination) const noexcept
+{
+    const auto x = juce::jlimit (0.0f, maxPosition, position) * (float) stepsPerVoice;
+    const auto index = (int) x;
+
+    if (index >= numSteps - 1)
+    {
+        std::copy (steps.back().begin(), steps.back().end(), destination);
+        return;
+    }
+
+    const auto fraction = x - (float) index;
+    const auto& a = steps[(size_t) index];
+    const auto& b = steps[(size_t) index + 1];
+
+    for (size_t i = 0; i < 5; ++i)
+        destination[i] = a[i] + fraction * (b[i] - a[i]);
+}
+
+bool VoiceMorphTable::isStable() const noexcept
+{
+    return std::all_of (steps.begin(), steps.end(), [] (const auto& c)
+    {
+        return std::abs (c[4]) < 1.0f && std::abs (c[3]) < 1.0f + c[4];
+    });
+}
+
+//==============================================================================
+VoiceLinearPhaseKernels::VoiceLinearPhaseKernels (double rate)
+    : sampleRate (rate),
+      kernelLength (juce::nextPowerOfTwo (juce::roundToInt (kernelSeconds * rate)) + 1),
+      fftOrder (juce::roundToInt (std::log2 (fftSizePerKernel * (kernelLength - 1)))),
+      fftSize (1 << fftOrder),
+      hopSize (fftSize - (kernelLength - 1))
+{
+    const juce::dsp::FFT fft (fftOrder);
+    const auto centre = (kernelLength - 1) / 2;
+    std::vector<juce::dsp::Complex<float>> correction ((size_t) fftSize), impulse ((size_t) fftSize), kernel ((size_t) fftSize);
+
+    for (size_t voice = 0; voice < spectra.size(); ++voice)
+    {
+        const auto peak = makeVoicePeak (sampleRate, voiceDesigns[voice]);
+        std::fill (kernel.begin(), kernel.end(), juce::dsp::Complex<float>());
+
+        // A flat voice has no phase to undo, so it's a plain delay
+        if (isIdentityBiquad (peak))
+        {
+            kernel[(size_t) centre] = 1.0f;
+        }
+        else
+        {
+            // conj (H) / |H| takes the filter's phase away and leaves its magnitude. It comes back
+            // as an impulse centred on sample 0, wrapping round, and real, as the bins are symmetric
+            for (int k = 0; k < fftSize; ++k)
+            {
+                const auto response = getResponse (peak, juce::MathConstants<double>::twoPi * k / fftSize);
+                const auto inverse = std::conj (response) / std::abs (response);
+                correction[(size_t) k] = { (float) inverse.real(), (float) inverse.imag() };
+            }
+
+            fft.perform (correction.data(), impulse.data(), true);
+
+            for (int n = 0; n < kernelLength; ++n)
+            {
+                const auto window = 0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * (n + 1) / (kernelLength + 1));
+                kernel[(size_t) n] = impulse[(size_t) ((n - centre + fftSize) % fftSize)].real() * (float) window;
+            }
+        }
+
+        spectra[voice].resize ((size_t) fftSize);
+        fft.perform (kernel.data(), spectra[voice].data(), false);
+    }
+}
+
+double VoiceLinearPhaseKernels::getMaxErrorDecibels() const
+{
+    auto maxError = 0.0;
+
+    for (size_t voice = 0; voice < spectra.size(); ++voice)
+    {
+        const auto peak = makeVoicePeak (sampleRate, voiceDesigns[voice]);
+
+        for (int k = 1; k < fftSize / 2; ++k)
+        {
+            const auto frequency = k * sampleRate / fftSize;
+
+            if (frequency < 20.0 || frequency > 20000.0)
+                continue;
+
+            // The filter then the kernel, against the filter's magnitude delayed by the centre tap
+            const auto omega = juce::MathConstants<double>::twoPi * k / fftSize;
+            const auto response = getResponse (peak, omega);
+            const auto& bin = spectra[voice][(size_t) k];
+            const auto actual = response * std::complex<double> (bin.real(), bin.imag());
+            const auto expected = std::polar (std::abs (response), -omega * ((kernelLength - 1) / 2));
+            maxError = juce::jmax (maxError, 20.0 * std::log10 (1.0 + std::abs (actual - expected) / std::abs (response)));
+        }
+    }
+
+    return maxError;
+}
+
+//==============================================================================
+const VoiceCoefficients& DspResources::getVoiceCoefficients (double sampleRate)
+{
+    const std::scoped_lock sl (lock);
+    auto& entry = voiceCoefficients[sampleRate];
+
+    if (entry == nullptr)
+    {
+        entry = std::make_unique<VoiceCoefficients>();
+
+        for (size_t voice = 0; voice < entry->peak.size(); ++voice)
+            entry->peak[voice] = makeVoicePeak (sampleRate, voiceDesigns[voice]);
+
+        entry->highPass = juce::dsp::IIR::ArrayCoefficients<float>::makeHighPass (sampleRate, 10.f);
+    }
+
+    return *entry;
+}
+
+const VoiceMorphTable& DspResources::getVoiceMorph (double sampleRate)
+{
+    const std::scoped_lock sl (lock);
+    auto& entry = voiceMorphs[sampleRate];
+
+    if (entry == nullptr)
+        entry = std::make_unique<VoiceMorphTable> (sampleRate);
+
+    return *entry;
+}
+
+const VoiceLinearPhaseKernels& DspResources::getVoiceLinearPhaseKernels (double sampleRate)
+{
+    const std::scoped_lock sl (lock);
+    auto& entry = voiceLinearPhaseKernels[sampleRate];
+
+    if (entry == nullptr)
+        entry = std::make_unique<VoiceLinearPhaseKernels> (sampleRate);
+
+    return *entry;
+}
+
+const BallisticsTable& DspResources::getBallistics (double sampleRate)
+{
+    const std::scoped_lock sl (lock);
+    auto& entry = ballistics[sampleRate];
+
+    if (entry == nullptr)
+        entry = std::make_unique<BallisticsTable> (sampleRate);
+
+    return *entry;
+}
+
+const GainCurveTable& DspResources::getGainCurve (float exponent)
+{
+    const std::scoped_lock sl (lock);
+    auto& entry = gainCurves[exponent];
+
+    if (entry == nullptr)
+        entry = std::make_unique<GainCurveTable> (exponent);
+
+    return *entry;
+}
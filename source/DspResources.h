@@ -0,0 +1,150 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include "GainCurveTable.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+//==============================================================================
+/** Voice EQ coefficients for one sample rate, as {b0, b1, b2, a0, a1, a2}. */
+struct VoiceCoefficients
+{
+    static constexpr int numVoices = 3;
+
+    std::array<std::array<float, 6>, numVoices> peak;
+    std::array<float, 6> highPass;
+};
+
+//==============================================================================
+/**
+    The voice peak filter swept continuously from the left voice (position 0)
+    through the middle one (1) to the right one (2), as normalised biquads
+    {b0, b1, b2, a1, a2}.
+
+    Between two voices the centre frequency, Q and gain move geometrically,
+    and the filter is designed with makePeakFilter at stepsPerVoice positions
+    each way. Positions in between are a linear interpolation of the two
+    nearest steps, which needs no trig and can't go unstable: every step's
+    denominator is inside the stability triangle (|a2| < 1, |a1| < 1 + a2),
+    which is convex, so every mix of two of them is inside it too. The whole
+    voice positions give exactly the coefficients of the VOICE switch.
+*/
+class VoiceMorphTable
+{
+public:
+    static constexpr int stepsPerVoice = 64;
+    static constexpr int numSteps = (VoiceCoefficients::numVoices - 1) * stepsPerVoice + 1;
+    static constexpr float maxPosition = (float) (VoiceCoefficients::numVoices - 1);
+
+    explicit VoiceMorphTable (double sampleRate);
+
+    /** position from 0 to maxPosition, clamped. */
+    void getCoefficients (float position, float* destination) const noexcept;
+
+    /** Whether every step is strictly inside the stability triangle (checked by the golden command). */
+    bool isStable() const noexcept;
+
+private:
+    std::array<std::array<float, 5>, numSteps> steps;
+};
+
+//==============================================================================
+/**
+    FIR kernels that undo the voice filters' phase, for LinearPhaseVoice.
+
+    LinearPhaseVoice runs after the voice filter, so each kernel is the
+    filter's conjugate over its magnitude, conj (H) / |H|, sampled on the
+    FFT's bins, taken back to the time domain, centred, and cut to
+    kernelLength taps under a Hann window. Filter and kernel together are the
+    filter's magnitude in linear phase. The length follows the sample rate
+    (kernelSeconds at least, as a power of two plus the centre tap), which
+    keeps every voice within 0.1 dB of that from 20 Hz to 20 kHz.
+
+    The kernels are kept as their FFTs at fftSize, ready for overlap-save:
+    each FFT takes hopSize new samples after the last kernelLength - 1.
+*/
+struct VoiceLinearPhaseKernels
+{
+    static constexpr double kernelSeconds = 0.02;
+
+    // The FFT is this many kernel lengths: 4 costs the least per sample (see bench), longer ones only add latency
+    static constexpr int fftSizePerKernel = 4;
+
+    explicit VoiceLinearPhaseKernels (double sampleRate);
+
+    /** The largest difference, in magnitude or phase, between filter and kernel and the filters' magnitude
+        in linear phase, from 20 Hz to 20 kHz (checked by the golden command).
+    */
+    double getMaxErrorDecibels() const;
+
+    double sampleRate;
+    int kernelLength, fftOrder, fftSize, hopSize;
+    std::array<std::vector<juce::dsp::Complex<float>>, VoiceCoefficients::numVoices> spectra;
+};
+
+//==============================================================================
+/**
+    Ballistics filter coefficients at one sample rate for every step of the
+    ATTACK parameter (1 to 100 ms by 0.1 ms), which also covers the release.
+    Times off that grid are calculated on the spot.
+*/
+class BallisticsTable
+{
+public:
+    static constexpr float minTimeMs = 1.0f;
+    static constexpr float stepMs = 0.1f;
+    static constexpr int numSteps = 991;
+
+    explicit BallisticsTable (double sampleRate);
+
+    /** Same as juce::dsp::BallisticsFilter. */
+    static float calculate (double sampleRate, float timeMs);
+
+    float operator() (float timeMs) const noexcept
+    {
+        const auto index = juce::roundToInt ((timeMs - minTimeMs) / stepMs);
+
+        if (juce::isPositiveAndBelow (index, numSteps) && juce::exactlyEqual (timeMs, getStepTime (index)))
+            return coefficients[(size_t) index];
+
+        return calculate (sampleRate, timeMs);
+    }
+
+private:
+    // The same float a parameter snapped to the 0.1 ms interval holds
+    static float getStepTime (int index) noexcept   { return minTimeMs + stepMs * (float) index; }
+
+    double sampleRate;
+    std::array<float, numSteps> coefficients;
+};
+
+//==============================================================================
+/**
+    Read-only DSP data shared by every PunkKomp instance in the process.
+
+    Hold it through a juce::SharedResourcePointer<DspResources>: it is created
+    with the first instance and freed with the last one. Entries are built on
+    first use and never change or move afterwards, so the references handed out
+    stay valid for as long as the holder keeps its pointer. Lookups lock, so do
+    them from prepareToPlay rather than from the audio callback.
+*/
+class DspResources
+{
+public:
+    const VoiceCoefficients& getVoiceCoefficients (double sampleRate);
+    const VoiceMorphTable& getVoiceMorph (double sampleRate);
+    const VoiceLinearPhaseKernels& getVoiceLinearPhaseKernels (double sampleRate);
+    const GainCurveTable& getGainCurve (float exponent);
+    const BallisticsTable& getBallistics (double sampleRate);
+
+private:
+    std::mutex lock;
+    std::map<double, std::unique_ptr<VoiceCoefficients>> voiceCoefficients;
+    std::map<double, std::unique_ptr<VoiceMorphTable>> voiceMorphs;
+    std::map<double, std::unique_ptr<VoiceLinearPhaseKernels>> voiceLinearPhaseKernels;
+    std::map<double, std::unique_ptr<BallisticsTable>> ballistics;
+    std::map<float, std::unique_ptr<GainCurveTable>> gainCurves;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "LevelHistory.h"
+
+namespace juce::Gui
+{
+    class GainReductionHistory : public juce::Component
+    {
+    public:
+        explicit GainReductionHistory(const LevelHistory& source) : history(source)
+        {
+            readPosition = history.getWritePosition();
+        }
+
+        void paint(juce::Graphics& g) override
+        {
+            auto bounds = getLocalBounds().toFloat().reduced(2.0f);
+
+            // Background colour
+            g.setColour(juce::Colours::black);
+            g.fillRoundedRectangle(bounds, 15.0f);
+
+            // The history is kept at physical pixel resolution, a scale change starts it afresh
+            const auto pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+            if (! juce::approximatelyEqual(pixelScale, imageScale))
+            {
+                imageScale = pixelScale;
+                createImage();
+            }
+
+            g.drawImageTransformed(historyImage, juce::AffineTransform::scale(1.0f / imageScale).translated(graphArea.toFloat().getPosition()));
+        }
+
+        void resized() override
+        {
+            graphArea = getLocalBounds().reduced(8, 3);
+            createImage();
+        }
+
+        void mouseUp(const juce::MouseEvent&) override
+        {
+            if (onClick != nullptr)
+                onClick();
+        }
+
+        // Number of LevelHistory frames written per second of audio
+        void setFrameRate(double framesPerSecond)
+        {
+            frameRate = framesPerSecond;
+            updateColumnSize();
+        }
+
+        // Pulls the frames written since the last call and draws the columns they complete.
+        // Only the new columns are drawn, the rest of the image is just shifted left.
+        void update()
+        {
+            if (! historyImage.isValid())
+            {
+                readPosition = history.getWritePosition();
+                return;
+            }
+
+            LevelHistory::Frame frames[256];
+
+            while (const int numFrames = history.pull(readPosition, frames, (int) std::size(frames)))
+            {
+                for (int i = 0; i < numFrames; ++i)
+                    addFrame(frames[i]);
+            }
+
+            if (pending.empty())
+                return;
+
+            drawPendingColumns();
+            repaint(graphArea);
+        }
+
+        std::function<void()> onClick;
+
+        // Length of the visible history in seconds
+        static constexpr double historySeconds = 5.0;
+
+    private:
+        struct Column
+        {
+            float minInput = 0.0f, maxInput = -100.0f;
+            float minReduction = 100.0f, maxReduction = 0.0f;
+        };
+
+        void createImage()
+        {
+            historyImage = juce::Image(juce::Image::ARGB,
+                                       juce::jmax(1, juce::roundToInt(graphArea.getWidth() * imageScale)),
+                                       juce::jmax(1, juce::roundToInt(graphArea.getHeight() * imageScale)),
+                                       true);
+
+            pending.clear();
+            pending.reserve((size_t) historyImage.getWidth());
+            updateColumnSize();
+        }
+
+        void updateColumnSize()
+        {
+            const auto framesPerSecond = frameRate > 0.0 ? frameRate : 48000.0 / LevelHistory::samplesPerFrame;
+            framesPerColumn = juce::jmax(1, juce::roundToInt(historySeconds * framesPerSecond / juce::jmax(1, historyImage.getWidth())));
+        }
+
+        void addFrame(const LevelHistory::Frame& frame)
+        {
+            if (columnFrames == 0)
+                current = { frame.inputDb, frame.inputDb, frame.reductionDb, frame.reductionDb };
+
+            current.minInput = juce::jmin(current.minInput, frame.inputDb);
+            current.maxInput = juce::jmax(current.maxInput, frame.inputDb);
+            current.minReduction = juce::jmin(current.minReduction, frame.reductionDb);
+            current.maxReduction = juce::jmax(current.maxReduction, frame.reductionDb);
+
+            if (++columnFrames < framesPerColumn)
+                return;
+
+            // Only the last image width worth of columns can ever be seen
+            if (pending.size() == (size_t) historyImage.getWidth())
+                pending.erase(pending.begin());
+
+            pending.push_back(current);
+            columnFrames = 0;
+        }
+
+        void drawPendingColumns()
+        {
+            const int width = historyImage.getWidth();
+            const int height = historyImage.getHeight();
+            const int numNew = (int) pending.size();
+
+            // Blit the existing columns to the left and clear the space for the new ones
+            if (numNew < width)
+                historyImage.moveImageSection(0, 0, numNew, 0, width - numNew, height);
+
+            historyImage.clear({ width - numNew, 0, numNew, height });
+
+            juce::Graphics g(historyImage);
+            const auto h = static_cast<float>(height);
+
+            for (int i = 0; i < numNew; ++i)
+            {
+                const auto& column = pending[(size_t) i];
+                const auto x = static_cast<float>(width - numNew + i);
+
+                // Input level, from the bottom up in the {-60, 0} dB range
+                const auto inTop = juce::jmap(juce::jlimit(-60.0f, 0.0f, column.maxInput), -60.0f, 0.0f, h, 0.0f);
+                const auto inBottom = juce::jmap(juce::jlimit(-60.0f, 0.0f, column.minInput), -60.0f, 0.0f, h, 0.0f);
+                g.setColour(juce::Colours::azure.withAlpha(0.35f));
+                g.fillRect(x, inTop, 1.0f, juce::jmax(1.0f, h - inTop));
+                g.setColour(juce::Colours::azure.withAlpha(0.6f));
+                g.fillRect(x, inTop, 1.0f, juce::jmax(1.0f, inBottom - inTop));
+
+                // Gain reduction, from the top down in the {0, 20} dB range
+                const auto grTop = juce::jmap(juce::jlimit(0.0f, 20.0f, column.minReduction), 0.0f, 20.0f, 0.0f, h);
+                const auto grBottom = juce::jmap(juce::jlimit(0.0f, 20.0f, column.maxReduction), 0.0f, 20.0f, 0.0f, h);
+                g.setColour(juce::Colours::red.withAlpha(0.4f));
+                g.fillRect(x, 0.0f, 1.0f, grTop);
+                g.setColour(juce::Colours::yellow);
+                g.fillRect(x, grTop, 1.0f, juce::jmax(1.0f, grBottom - grTop));
+            }
+
+            pending.clear();
+        }
+
+        const LevelHistory& history;
+        juce::uint64 readPosition = 0;
+        double frameRate = 0.0;
+
+        int framesPerColumn = 1;
+        int columnFrames = 0;
+        Column current;
+        std::vector<Column> pending;
+
+        juce::Rectangle<int> graphArea;
+        juce::Image historyImage;
+        float imageScale = 1.0f;
+    };
+}
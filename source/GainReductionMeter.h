@@ -1,14 +1,12 @@
 #pragma once
 
+#include <juce_gui_basics/juce_gui_basics.h>
+
 namespace juce::Gui
 {
     class GainReductionMeter : public juce::Component
     {
     public:
-        GainReductionMeter(){
-            grMeterImage = juce::ImageCache::getFromMemory(BinaryData::grMeter_png, BinaryData::grMeter_pngSize);
-        }
-        
         void paint(juce::Graphics& g) override
         {
             auto bounds = getLocalBounds().toFloat().reduced(2.0f);
@@ -27,7 +25,8 @@ namespace juce::Gui
         
         void paintOverChildren(juce::Graphics& g) override
         {
-            g.drawImage(grMeterImage, getLocalBounds().toFloat());
+            g.setColour(juce::Colours::black);
+            g.fillPath(bezel);
         }
         
         void resized() override
@@ -42,14 +41,46 @@ namespace juce::Gui
                 false
             };
             gradient.addColour(0.7, juce::Colours::yellow);
+            
+            bezel = makeBezel(bounds);
         }
         
+        void mouseUp(const juce::MouseEvent&) override
+        {
+            if (onClick != nullptr)
+                onClick();
+        }
+
         void setLevel(const float value) { level = value; }
-        
+
+        std::function<void()> onClick;
+
     private:
+        // The black bezel with a row of round windows onto the level, as a path so it stays sharp
+        // at any size like the knobs (it replaces the grMeter.png artwork, taken out of the assets
+        // as they all go into the binary). Only rebuilt when the size changes.
+        static juce::Path makeBezel(juce::Rectangle<float> bounds)
+        {
+            // Proportions of the artwork, 346x32 with 20 windows
+            constexpr int numWindows = 20;
+            const auto firstX = bounds.getX() + bounds.getWidth() * (22.0f / 346.0f);
+            const auto spacing = bounds.getWidth() * (306.0f / 346.0f) / (numWindows - 1);
+            const auto radius = bounds.getHeight() * (6.0f / 32.0f);
+            
+            juce::Path path;
+            path.addRoundedRectangle(bounds, bounds.getHeight() * 0.5f);
+            
+            for (int i = 0; i < numWindows; ++i)
+                path.addEllipse(firstX + spacing * i - radius, bounds.getCentreY() - radius, radius * 2.0f, radius * 2.0f);
+            
+            // The windows are holes
+            path.setUsingNonZeroWinding(false);
+            return path;
+        }
+        
         float level = 0.0f;
         juce::ColourGradient gradient{};
-        juce::Image grMeterImage;
+        juce::Path bezel;
     };
 }
 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <map>
+#include <tuple>
+
+namespace juce::Gui
+{
+    // Images shared by every open PunkKomp editor in the process: the decoded
+    // BinaryData assets and their copies resampled or rendered for a given pixel
+    // size. Hold it through a juce::SharedResourcePointer<ImageResources>, it goes
+    // away with the last PunkKomp instance (every processor holds one too, so a
+    // session doesn't decode the assets again each time an editor opens). Use it
+    // on the message thread only.
+    //
+    // juce::Image is reference counted, so a cached copy nobody draws any more has
+    // a count of one and is dropped the next time something new is added.
+    class ImageResources
+    {
+    public:
+        using Renderer = juce::Image (*)(int width, int height);
+
+        juce::Image getImage(const void* data, int dataSize)
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            auto& image = decoded[data];
+
+            if (! image.isValid())
+                image = juce::ImageFileFormat::loadFrom(data, (size_t) dataSize);
+
+            return image;
+        }
+
+        juce::Image getScaled(const juce::Image& source, int width, int height)
+        {
+            return find({ source.getPixelData(), width, height }, [&] {
+                return source.rescaled(width, height, juce::Graphics::highResamplingQuality);
+            });
+        }
+
+        juce::Image getRendered(Renderer render, int width, int height)
+        {
+            return find({ reinterpret_cast<const void*>(render), width, height }, [&] {
+                return render(width, height);
+            });
+        }
+
+    private:
+        using Key = std::tuple<const void*, int, int>;
+
+        template <typename Create>
+        juce::Image find(const Key& key, Create&& create)
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            if (auto it = sized.find(key); it != sized.end())
+                return it->second;
+
+            purgeUnused();
+            return sized[key] = create();
+        }
+
+        void purgeUnused()
+        {
+            for (auto it = sized.begin(); it != sized.end();)
+                it = it->second.getReferenceCount() <= 1 ? sized.erase(it) : std::next(it);
+        }
+
+        std::map<const void*, juce::Image> decoded;
+        std::map<Key, juce::Image> sized;
+    };
+}
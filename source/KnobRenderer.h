@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ImageResources.h"
+
+namespace juce::Gui
+{
+    // Vector knob: the body is rendered into an image at the physical pixel size
+    // it is shown at (only when that size changes) and the pointer is drawn on top
+    // as a path every frame, so it stays sharp at any editor size or screen scale.
+    // It replaces the knob.png artwork, which is gone from the assets on purpose:
+    // everything in there is embedded in the binary, used or not.
+    class KnobRenderer
+    {
+    public:
+        void draw(juce::Graphics& g, juce::Rectangle<float> area, float radians)
+        {
+            const auto pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+            const auto width = juce::jmax(1, juce::roundToInt(area.getWidth() * pixelScale));
+
+            if (body.getWidth() != width)
+            {
+                body = {};
+                body = resources->getRendered(renderBody, width, width);
+            }
+
+            g.drawImageTransformed(body, juce::AffineTransform::scale(1.0f / pixelScale).translated(area.getX(), area.getY()));
+
+            // Pointer
+            const auto radius = area.getWidth() * 0.5f;
+            const auto thickness = radius * 0.14f;
+            juce::Path pointer;
+            pointer.addRoundedRectangle(-thickness * 0.5f, -radius * 0.78f, thickness, radius * 0.42f, thickness * 0.5f);
+
+            g.setColour(juce::Colours::white.withAlpha(0.92f));
+            g.fillPath(pointer, juce::AffineTransform::rotation(radians).translated(area.getCentre()));
+        }
+
+    private:
+        static juce::Image renderBody(int size, int /*height*/)
+        {
+            juce::Image image(juce::Image::ARGB, size, size, true);
+            juce::Graphics g(image);
+
+            const auto bounds = image.getBounds().toFloat();
+            const auto centre = bounds.getCentre();
+
+            // Outer ring
+            g.setColour(juce::Colour(0xff0d0d0d));
+            g.fillEllipse(bounds);
+
+            // Body
+            const auto face = bounds.reduced(size * 0.06f);
+            g.setGradientFill(juce::ColourGradient(juce::Colour(0xff4a4a4a), centre.x, face.getY(),
+                                                   juce::Colour(0xff151515), centre.x, face.getBottom(), false));
+            g.fillEllipse(face);
+
+            // Top face with a soft radial sheen
+            const auto top = face.reduced(size * 0.05f);
+            g.setGradientFill(juce::ColourGradient(juce::Colour(0xff3c3c3c), centre.x, centre.y,
+                                                   juce::Colour(0xff1e1e1e), top.getRight(), centre.y, true));
+            g.fillEllipse(top);
+
+            g.setColour(juce::Colours::white.withAlpha(0.08f));
+            g.drawEllipse(top, juce::jmax(1.0f, size * 0.01f));
+
+            return image;
+        }
+
+        juce::SharedResourcePointer<ImageResources> resources;
+        juce::Image body;
+    };
+}
@@ -0,0 +1,224 @@
+#include "KompBatch.h"
+
+//==============================================================================
+void KompBatch::prepare (double sampleRate, int newNumStreams, const KompDispatch::Variant& newVariant)
+{
+    jassert (sampleRate > 0 && newNumStreams > 0);
+    jassert (newVariant.processBatch != nullptr);
+
+    variant = &newVariant;
+    numStreams = newNumStreams;
+    laneWidth = variant->laneWidth;
+    numGroups = (numStreams + laneWidth - 1) / laneWidth;
+
+    ballistics = &resources->getBallistics (sampleRate);
+    voices = &resources->getVoiceCoefficients (sampleRate);
+
+    // What KompParameters::setFixedParameters gives the engine
+    coefficients.gainCurve = &resources->getGainCurve (1.0f / KompParameters::ratio - 1.0f);
+    coefficients.release = (*ballistics) (KompParameters::releaseMs);
+    normaliseBiquad (voices->highPass, coefficients.highPass);
+
+    const auto width = (size_t) laneWidth;
+    float** ramps[] = { &inputRamp, &outputRamp, &dryRamp, &wetRamp, &thresholdRamp, &attackRamp };
+    ScratchArena::Buffer rampBuffers[std::size (ramps)];
+
+    scratch.beginLayout();
+
+    const auto stateBuffer = scratch.reserve<float> ((size_t) numGroups * sizeof (KompState<float>) / sizeof (float) * width);
+    const auto peakBuffer = scratch.reserve<float> ((size_t) numGroups * 5 * width);
+
+    for (auto& buffer : rampBuffers)
+        buffer = scratch.reserve<float> ((size_t) chunkSize * width);
+
+    const auto laneBuffers = scratch.reserve<KompDispatch::WidestLane> ((size_t) chunkSize);
+
+    scratch.allocate();
+
+    states = scratch.get<float> (stateBuffer);
+    peaks = scratch.get<float> (peakBuffer);
+
+    for (size_t i = 0; i < std::size (ramps); ++i)
+        *ramps[i] = scratch.get<float> (rampBuffers[i]);
+
+    laneBuffer = scratch.get<KompDispatch::WidestLane> (laneBuffers);
+
+    streams.clear();
+    streams.resize ((size_t) numStreams);
+
+    for (int i = 0; i < numStreams; ++i)
+    {
+        auto& stream = streams[(size_t) i];
+
+        stream.inputGain.reset (sampleRate, KompEngine::gainRampSeconds);
+        stream.outputGain.reset (sampleRate, KompEngine::gainRampSeconds);
+        stream.dryVolume.reset (sampleRate, KompEngine::controlRampSeconds);
+        stream.wetVolume.reset (sampleRate, KompEngine::controlRampSeconds);
+        stream.thresholdInverse.reset (sampleRate, KompEngine::controlRampSeconds);
+        stream.attack.reset (sampleRate, KompEngine::controlRampSeconds);
+
+        setParameters (i, {});
+    }
+
+    reset();
+}
+
+void KompBatch::reset()
+{
+    std::fill (states, getStateLanes (numGroups, 0), 0.0f);
+
+    for (auto& stream : streams)
+    {
+        for (auto* value : { &stream.inputGain, &stream.outputGain, &stream.dryVolume, &stream.wetVolume, &stream.attack })
+            value->setCurrentAndTargetValue (value->getTargetValue());
+
+        stream.thresholdInverse.setCurrentAndTargetValue (stream.thresholdInverse.getTargetValue());
+    }
+}
+
+//==============================================================================
+void KompBatch::setParameters (int stream, const Parameters& newParameters)
+{
+    jassert (juce::isPositiveAndBelow (stream, numStreams));
+
+    auto& s = streams[(size_t) stream];
+    s.parameters = newParameters;
+
+    // The targets KompEngine's setters work out, from the values the processor passes them
+    const auto comp = newParameters.comp;
+    s.inputGain.setTargetValue (juce::Decibels::decibelsToGain (KompParameters::getInputGainDecibels (comp)));
+    s.thresholdInverse.setTargetValue (1.0f / juce::Decibels::decibelsToGain (KompParameters::getThresholdDecibels (comp), -200.0f));
+    s.attack.setTargetValue ((*ballistics) (newParameters.attackMs));
+
+    const auto mix = juce::jlimit (0.0f, 1.0f, KompParameters::getWetProportion (newParameters.mix));
+    s.dryVolume.setTargetValue (1.0f - mix);
+    s.wetVolume.setTargetValue (mix);
+
+    s.outputGain.setTargetValue (juce::Decibels::decibelsToGain (newParameters.levelDecibels));
+
+    setVoice (stream, newParameters.voice);
+}
+
+void KompBatch::setVoice (int stream, int newVoice)
+{
+    auto& s = streams[(size_t) stream];
+    newVoice = juce::jlimit (0, VoiceCoefficients::numVoices - 1, newVoice);
+
+    if (newVoice == s.voice)
+        return;
+
+    const auto& c = voices->peak[(size_t) newVoice];
+    const auto group = stream / laneWidth;
+    const auto lane = (size_t) (stream % laneWidth);
+
+    s.voice = newVoice;
+    s.peakIsFlat = isIdentityBiquad (c);
+
+    // A flat stream may share its group with voiced ones, so it runs the exact identity filter,
+    // whose state has to be zero to pass the samples through untouched
+    float normalised[5] { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    if (s.peakIsFlat)
+    {
+        auto* peakState = getStateLanes (group, offsetof (KompState<float>, peak));
+        peakState[lane] = peakState[(size_t) laneWidth + lane] = 0.0f;
+    }
+    else
+    {
+        normaliseBiquad (c, normalised);
+    }
+
+    auto* peak = peaks + (size_t) group * 5 * (size_t) laneWidth;
+
+    for (size_t i = 0; i < 5; ++i)
+        peak[i * (size_t) laneWidth + lane] = normalised[i];
+}
+
+float* KompBatch::getStateLanes (int group, size_t offset) const noexcept
+{
+    // A group's KompState of lanes is a KompState<float> with every value widened to laneWidth
+    constexpr auto valuesPerState = sizeof (KompState<float>) / sizeof (float);
+    return states + ((size_t) group * valuesPerState + offset / sizeof (float)) * (size_t) laneWidth;
+}
+
+//==============================================================================
+void KompBatch::fillRamps (int firstStream, int numSamples) noexcept
+{
+    const auto numLanes = juce::jmin (laneWidth, numStreams - firstStream);
+
+    // Every sample starts as a copy of the lanes' targets, then the lanes still moving overwrite theirs.
+    // Lanes past the last stream stay at zero, which the kernel turns into silence.
+    const auto fill = [&] (auto Stream::* value, float* ramp)
+    {
+        float steady[KompDispatch::maxLaneWidth] {};
+        auto anySmoothing = false;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const auto& smoothed = streams[(size_t) (firstStream + lane)].*value;
+            steady[lane] = smoothed.getTargetValue();
+            anySmoothing = anySmoothing || smoothed.isSmoothing();
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            std::copy (steady, steady + laneWidth, ramp + i * laneWidth);
+
+        if (anySmoothing)
+        {
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                auto& smoothed = streams[(size_t) (firstStream + lane)].*value;
+
+                if (smoothed.isSmoothing())
+                    for (int i = 0; i < numSamples; ++i)
+                        ramp[i * laneWidth + lane] = smoothed.getNextValue();
+            }
+        }
+    };
+
+    fill (&Stream::inputGain, inputRamp);
+    fill (&Stream::outputGain, outputRamp);
+    fill (&Stream::dryVolume, dryRamp);
+    fill (&Stream::wetVolume, wetRamp);
+    fill (&Stream::thresholdInverse, thresholdRamp);
+    fill (&Stream::attack, attackRamp);
+}
+
+void KompBatch::process (float* const* buffers, int numSamples) noexcept
+{
+    jassert (variant != nullptr);    // not prepared
+
+    // The plugin processes with denormals flushed to zero, which changes the filters' tails
+    juce::ScopedNoDenormals noDenormals;
+
+    KompDispatch::BatchGroup batch;
+    batch.ramps = { inputRamp, dryRamp, wetRamp, outputRamp, thresholdRamp, attackRamp };
+
+    float* chunk[KompDispatch::maxLaneWidth];
+    batch.streams = chunk;
+
+    // A group at a time, so its state and voice filters stay in cache for the whole block
+    for (int group = 0; group < numGroups; ++group)
+    {
+        const auto firstStream = group * laneWidth;
+
+        batch.numStreams = juce::jmin (laneWidth, numStreams - firstStream);
+        batch.peak = peaks + (size_t) group * 5 * (size_t) laneWidth;
+        batch.state = getStateLanes (group, 0);
+        batch.withPeak = false;
+
+        for (int lane = 0; lane < batch.numStreams; ++lane)
+            batch.withPeak = batch.withPeak || ! streams[(size_t) (firstStream + lane)].peakIsFlat;
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            batch.numSamples = juce::jmin (chunkSize, numSamples - start);
+
+            for (int lane = 0; lane < batch.numStreams; ++lane)
+                chunk[lane] = buffers[firstStream + lane] + start;
+
+            fillRamps (firstStream, batch.numSamples);
+            variant->processBatch (batch, coefficients, laneBuffer);
+        }
+    }
+}
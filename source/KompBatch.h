@@ -0,0 +1,96 @@
+#pragma once
+
+#include "KompParameters.h"
+
+//==============================================================================
+/**
+    Many independent mono PunkKomps run in lockstep, one per lane of the widest
+    kernel variant, so a pass of the kernel does 16 streams on AVX-512 or 8 on
+    AVX2 where a plugin instance would do one.
+
+    Every stream has its own COMP, ATTACK, MIX, VOICE and LEVEL, and gives the
+    same samples as a mono PunkKompProcessor set to them (LINK and the band
+    parameters have nothing to do on one channel, the batch is always the
+    plain compressor), only without the processor's latency: the batch has no
+    safety limiter, so no lookahead. The ramps, voice filters and kernel states of all the
+    streams are kept as arrays interleaved by lane, in one arena, and the
+    streams go through the kernel chunkSize samples at a time so the ramps
+    stay in cache.
+
+    Parameters set between process calls start moving on the next sample, as
+    with KompEngine. The plugin picks its parameters up every chunkSize
+    samples, so changes on that grid follow it sample for sample.
+*/
+class KompBatch
+{
+public:
+    static constexpr int chunkSize = 32;
+
+    /** One stream's settings, in the plain units of the plugin's parameters. */
+    struct Parameters
+    {
+        float comp = DEFAULT_COMP;
+        float attackMs = DEFAULT_ATTACK;
+        float mix = DEFAULT_MIX;
+        int voice = DEFAULT_VOICE;
+        float levelDecibels = DEFAULT_OUTPUT;
+    };
+
+    //==============================================================================
+    /** Allocates for numStreams streams, which all start at the plugin's defaults.
+        The variant has to have a batch function, the default is the widest one.
+    */
+    void prepare (double sampleRate, int numStreams, const KompDispatch::Variant& variant = KompDispatch::chooseBatch());
+
+    /** Clears every stream's state, and finishes the ramps. */
+    void reset();
+
+    void setParameters (int stream, const Parameters& newParameters);
+    const Parameters& getParameters (int stream) const noexcept     { return streams[(size_t) stream].parameters; }
+
+    int getNumStreams() const noexcept                              { return numStreams; }
+    const KompDispatch::Variant& getVariant() const noexcept        { return *variant; }
+    size_t getScratchBytes() const noexcept                         { return scratch.getNumBytes(); }
+
+    //==============================================================================
+    /** Processes getNumStreams() buffers of numSamples in place. */
+    void process (float* const* buffers, int numSamples) noexcept;
+
+private:
+    struct Stream
+    {
+        Parameters parameters;
+        int voice = -1;
+        bool peakIsFlat = false;
+
+        juce::SmoothedValue<float> inputGain, outputGain, dryVolume, wetVolume, attack;
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> thresholdInverse { 1.0f };
+    };
+
+    void setVoice (int stream, int newVoice);
+    void fillRamps (int firstStream, int numSamples) noexcept;
+    float* getStateLanes (int group, size_t offset) const noexcept;
+
+    //==============================================================================
+    juce::SharedResourcePointer<DspResources> resources;
+    const BallisticsTable* ballistics = nullptr;
+    const VoiceCoefficients* voices = nullptr;
+
+    const KompDispatch::Variant* variant = nullptr;
+    int numStreams = 0, laneWidth = 0, numGroups = 0;
+
+    KompCoefficients coefficients;      // gain curve, release and high pass, the same for every stream
+    std::vector<Stream> streams;
+
+    // Every buffer below lives in the arena, laid out by prepare
+    ScratchArena scratch;
+    float* states = nullptr;            // a KompState of lanes per group
+    float* peaks = nullptr;             // five lanes of voice filter coefficients per group
+    float* inputRamp = nullptr;         // chunkSize lanes each, for the group being processed
+    float* outputRamp = nullptr;
+    float* dryRamp = nullptr;
+    float* wetRamp = nullptr;
+    float* thresholdRamp = nullptr;
+    float* attackRamp = nullptr;
+    KompDispatch::WidestLane* laneBuffer = nullptr;
+};
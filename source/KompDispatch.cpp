@@ -0,0 +1,407 @@
+#include "KompDispatch.h"
+
+namespace KompDispatch
+{
+    namespace
+    {
+        //==============================================================================
+        // Moving channels in and out of the lanes is a transpose, done a square tile of
+        // samples at a time: each in pointer is a row of the tile, each out pointer the
+        // place for a column
+       #if JUCE_USE_SIMD && JUCE_INTEL
+        inline void transposeTile (const float* const (&in)[4], float* const (&out)[4]) noexcept
+        {
+            auto r0 = _mm_loadu_ps (in[0]), r1 = _mm_loadu_ps (in[1]), r2 = _mm_loadu_ps (in[2]), r3 = _mm_loadu_ps (in[3]);
+            _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+
+            _mm_storeu_ps (out[0], r0);
+            _mm_storeu_ps (out[1], r1);
+            _mm_storeu_ps (out[2], r2);
+            _mm_storeu_ps (out[3], r3);
+        }
+       #endif
+
+       #if PUNKKOMP_X86_DISPATCH
+        __attribute__ ((target ("avx2")))
+        inline void transposeTile (const float* const (&in)[8], float* const (&out)[8]) noexcept
+        {
+            __m256 r[8], t[8];
+
+            for (int i = 0; i < 8; ++i)
+                r[i] = _mm256_loadu_ps (in[i]);
+
+            for (int i = 0; i < 8; i += 2)
+            {
+                t[i]     = _mm256_unpacklo_ps (r[i], r[i + 1]);
+                t[i + 1] = _mm256_unpackhi_ps (r[i], r[i + 1]);
+            }
+
+            for (int i = 0; i < 8; i += 4)
+            {
+                r[i]     = _mm256_shuffle_ps (t[i],     t[i + 2], _MM_SHUFFLE (1, 0, 1, 0));
+                r[i + 1] = _mm256_shuffle_ps (t[i],     t[i + 2], _MM_SHUFFLE (3, 2, 3, 2));
+                r[i + 2] = _mm256_shuffle_ps (t[i + 1], t[i + 3], _MM_SHUFFLE (1, 0, 1, 0));
+                r[i + 3] = _mm256_shuffle_ps (t[i + 1], t[i + 3], _MM_SHUFFLE (3, 2, 3, 2));
+            }
+
+            for (int i = 0; i < 4; ++i)
+            {
+                _mm256_storeu_ps (out[i],     _mm256_permute2f128_ps (r[i], r[i + 4], 0x20));
+                _mm256_storeu_ps (out[i + 4], _mm256_permute2f128_ps (r[i], r[i + 4], 0x31));
+            }
+        }
+       #endif
+
+        // Side of the tiles for each lane type, 1 where there's no transposeTile for it
+        template <typename Lane>
+        constexpr int tileSize = 1;
+
+       #if JUCE_USE_SIMD && JUCE_INTEL
+        template <>
+        constexpr int tileSize<LaneOps::Vector> = 4;
+       #endif
+
+       #if PUNKKOMP_X86_DISPATCH
+        template <>
+        constexpr int tileSize<LaneOps::Lanes<8>> = 8;
+
+        template <>
+        constexpr int tileSize<LaneOps::Lanes<16>> = 8;
+       #endif
+
+        // Copies the channels into the first numChannels lanes of an interleaved buffer, which
+        // holds laneWidth floats per sample. The samples after the last whole tile go one by one.
+        template <typename Lane>
+        void copyToLanes (const float* const* channels, int numChannels, float* interleaved, int numSamples) noexcept
+        {
+            constexpr int laneWidth = LaneOps::width<Lane>;
+            constexpr int tile = tileSize<Lane>;
+            auto i = 0;
+
+            if constexpr (tile > 1)
+            {
+                static const float silence[tile] {};
+
+                for (; i + tile <= numSamples; i += tile)
+                {
+                    for (int first = 0; first < numChannels; first += tile)
+                    {
+                        const float* in[tile];
+                        float* out[tile];
+
+                        for (int row = 0; row < tile; ++row)
+                        {
+                            in[row] = first + row < numChannels ? channels[first + row] + i : silence;
+                            out[row] = interleaved + (size_t) (i + row) * laneWidth + (size_t) first;
+                        }
+
+                        transposeTile (in, out);
+                    }
+                }
+            }
+
+            for (int lane = 0; lane < numChannels; ++lane)
+                for (int j = i; j < numSamples; ++j)
+                    interleaved[j * laneWidth + lane] = channels[lane][j];
+        }
+
+        // And back out of the lanes
+        template <typename Lane>
+        void copyFromLanes (const float* interleaved, float* const* channels, int numChannels, int numSamples) noexcept
+        {
+            constexpr int laneWidth = LaneOps::width<Lane>;
+            constexpr int tile = tileSize<Lane>;
+            auto i = 0;
+
+            if constexpr (tile > 1)
+            {
+                float unused[tile];
+
+                for (; i + tile <= numSamples; i += tile)
+                {
+                    for (int first = 0; first < numChannels; first += tile)
+                    {
+                        const float* in[tile];
+                        float* out[tile];
+
+                        for (int row = 0; row < tile; ++row)
+                        {
+                            in[row] = interleaved + (size_t) (i + row) * laneWidth + (size_t) first;
+                            out[row] = first + row < numChannels ? channels[first + row] + i : unused;
+                        }
+
+                        transposeTile (in, out);
+                    }
+                }
+            }
+
+            for (int lane = 0; lane < numChannels; ++lane)
+                for (int j = i; j < numSamples; ++j)
+                    channels[lane][j] = interleaved[j * laneWidth + lane];
+        }
+
+        //==============================================================================
+        // Copies the filter and detector state between one channel and one lane of a group
+        template <typename Lane, typename Copy>
+        void forEachStateValue (KompState<Lane>& group, KompState<float>& channel, Copy&& copy)
+        {
+            copy (group.envelope, channel.envelope);
+
+            for (size_t i = 0; i < 2; ++i)
+            {
+                copy (group.peak[i], channel.peak[i]);
+                copy (group.highPass[i], channel.highPass[i]);
+            }
+        }
+
+        template <typename Lane, bool WithPeak>
+        void runKomp (KompDetector detector, Lane* samples, int numSamples, KompState<Lane>& state,
+                      const KompCoefficients& c, const KompRamps& ramps, const Lane* external) noexcept
+        {
+            if (detector == KompDetector::external)
+                processKomp<Lane, KompDetector::external, WithPeak> (samples, numSamples, state, c, ramps, external);
+            else if (detector == KompDetector::linked)
+                processKomp<Lane, KompDetector::linked, WithPeak> (samples, numSamples, state, c, ramps);
+            else
+                processKomp<Lane, KompDetector::perLane, WithPeak> (samples, numSamples, state, c, ramps);
+        }
+
+        template <typename Lane, bool WithPeak>
+        KompLevels processGroups (const Block& block, KompDetector detector, KompState<float>* states,
+                                  const KompCoefficients& c, const KompRamps& ramps, WidestLane* scratch) noexcept
+        {
+            constexpr int laneWidth = LaneOps::width<Lane>;
+            static_assert (sizeof (Lane) <= sizeof (WidestLane));
+
+            const auto numSamples = block.numSamples;
+            auto* lanes = reinterpret_cast<Lane*> (scratch);
+            auto* externalLanes = reinterpret_cast<Lane*> (scratch + numSamples);
+            const auto useExternal = detector == KompDetector::external;
+
+            // The samples are moved in and out as plain floats, see copyToLanes
+            static_assert (sizeof (Lane) == laneWidth * sizeof (float));
+            auto* interleaved = reinterpret_cast<float*> (lanes);
+            auto* interleavedExternal = reinterpret_cast<float*> (externalLanes);
+
+            KompLevels levels;
+
+            for (int firstChannel = 0; firstChannel < block.numChannels; firstChannel += laneWidth)
+            {
+                const auto numLanes = juce::jmin (laneWidth, block.numChannels - firstChannel);
+
+                // Gather the group's channels into the lanes, unused lanes stay silent
+                if (numLanes < laneWidth)
+                {
+                    std::fill (lanes, lanes + numSamples, Lane {});
+
+                    if (useExternal)
+                        std::fill (externalLanes, externalLanes + numSamples, Lane {});
+                }
+
+                copyToLanes<Lane> (block.channels + firstChannel, numLanes, interleaved, numSamples);
+
+                if (useExternal)
+                    copyToLanes<Lane> (block.external + firstChannel, numLanes, interleavedExternal, numSamples);
+
+                KompState<Lane> state;
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    forEachStateValue (state, states[firstChannel + lane], [lane] (Lane& group, float& value) { LaneOps::setLane (group, (size_t) lane, value); });
+
+                runKomp<Lane, WithPeak> (detector, lanes, numSamples, state, c, ramps, externalLanes);
+
+                levels.input = juce::jmax (levels.input, LaneOps::horizontalMax (state.inputLevel, numLanes));
+                levels.compressed = juce::jmax (levels.compressed, LaneOps::horizontalMax (state.compressedLevel, numLanes));
+
+                // Scatter back
+                copyFromLanes<Lane> (interleaved, block.channels + firstChannel, numLanes, numSamples);
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    forEachStateValue (state, states[firstChannel + lane], [lane] (Lane& group, float& value) { value = LaneOps::getLane (group, (size_t) lane); });
+            }
+
+            return levels;
+        }
+
+        //==============================================================================
+        // One KompBatch stream per lane, with the ramps and the voice filter read per lane
+        template <typename Lane>
+        void processBatchGroup (const BatchGroup& group, const KompCoefficients& c, WidestLane* scratch) noexcept
+        {
+            constexpr int laneWidth = LaneOps::width<Lane>;
+            static_assert (sizeof (Lane) == laneWidth * sizeof (float));
+            static_assert (sizeof (KompState<Lane>) == sizeof (KompState<float>) * laneWidth);
+
+            const auto numSamples = group.numSamples;
+            auto* lanes = reinterpret_cast<Lane*> (scratch);
+            auto* interleaved = reinterpret_cast<float*> (lanes);
+
+            if (group.numStreams < laneWidth)
+                std::fill (lanes, lanes + numSamples, Lane {});
+
+            copyToLanes<Lane> (group.streams, group.numStreams, interleaved, numSamples);
+
+            const auto asLanes = [] (const float* values) { return reinterpret_cast<const Lane*> (values); };
+
+            const KompLaneRamps<Lane> ramps { asLanes (group.ramps.input), asLanes (group.ramps.dry), asLanes (group.ramps.wet),
+                                              asLanes (group.ramps.output), asLanes (group.ramps.thresholdInverse), asLanes (group.ramps.attack) };
+
+            KompLaneCoefficients<Lane> coefficients;
+            coefficients.gainCurve = c.gainCurve;
+            coefficients.release = c.release;
+            std::copy (asLanes (group.peak), asLanes (group.peak) + 5, coefficients.peak);
+            std::copy (c.highPass, c.highPass + 5, coefficients.highPass);
+
+            auto& state = *reinterpret_cast<KompState<Lane>*> (group.state);
+
+            if (group.withPeak)
+                processKomp<Lane, KompDetector::perLane, true> (lanes, numSamples, state, coefficients, ramps);
+            else
+                processKomp<Lane, KompDetector::perLane, false> (lanes, numSamples, state, coefficients, ramps);
+
+            copyFromLanes<Lane> (interleaved, group.streams, group.numStreams, numSamples);
+        }
+
+        //==============================================================================
+        // Runs the scalar kernel straight on the host's buffer, nothing to gather
+        template <bool WithPeak>
+        KompLevels processChannel (const Block& block, int channel, KompDetector detector, KompState<float>* states,
+                                   const KompCoefficients& c, const KompRamps& ramps) noexcept
+        {
+            auto& state = states[channel];
+            state.inputLevel = state.compressedLevel = 0.0f;
+
+            const auto* external = block.external != nullptr ? block.external[channel] : nullptr;
+            runKomp<float, WithPeak> (detector, block.channels[channel], block.numSamples, state, c, ramps, external);
+
+            return { state.inputLevel, state.compressedLevel };
+        }
+
+        template <bool WithPeak>
+        KompLevels processMono (const Block& block, KompDetector detector, KompState<float>* states,
+                                const KompCoefficients& c, const KompRamps& ramps, WidestLane*) noexcept
+        {
+            jassert (block.numChannels == 1);
+            return processChannel<WithPeak> (block, 0, detector, states, c, ramps);
+        }
+
+        // Channels that don't share a detector go through the scalar kernel one after the other,
+        // which beats a half empty vector. Linked channels have to run side by side, so they stay
+        // on the baseline: two lane groups measured slower than the four lane vector.
+        template <bool WithPeak>
+        KompLevels processStereo (const Block& block, KompDetector detector, KompState<float>* states,
+                                  const KompCoefficients& c, const KompRamps& ramps, WidestLane* scratch) noexcept
+        {
+            jassert (block.numChannels <= 2);
+
+            if (detector == KompDetector::linked)
+                return processGroups<LaneOps::Vector, WithPeak> (block, detector, states, c, ramps, scratch);
+
+            KompLevels levels;
+
+            for (int channel = 0; channel < block.numChannels; ++channel)
+            {
+                const auto channelLevels = processChannel<WithPeak> (block, channel, detector, states, c, ramps);
+                levels.input = juce::jmax (levels.input, channelLevels.input);
+                levels.compressed = juce::jmax (levels.compressed, channelLevels.compressed);
+            }
+
+            return levels;
+        }
+
+        template <bool WithPeak>
+        KompLevels processBaseline (const Block& block, KompDetector detector, KompState<float>* states,
+                                    const KompCoefficients& c, const KompRamps& ramps, WidestLane* scratch) noexcept
+        {
+            return processGroups<LaneOps::Vector, WithPeak> (block, detector, states, c, ramps, scratch);
+        }
+
+        void processBatchBaseline (const BatchGroup& group, const KompCoefficients& c, WidestLane* scratch) noexcept
+        {
+            processBatchGroup<LaneOps::Vector> (group, c, scratch);
+        }
+
+       #if PUNKKOMP_X86_DISPATCH
+        // flatten inlines everything the kernel calls, so all of it is compiled for the target
+        template <bool WithPeak>
+        __attribute__ ((target ("avx2"), flatten))
+        KompLevels processAVX2 (const Block& block, KompDetector detector, KompState<float>* states,
+                                const KompCoefficients& c, const KompRamps& ramps, WidestLane* scratch) noexcept
+        {
+            return processGroups<LaneOps::Lanes<8>, WithPeak> (block, detector, states, c, ramps, scratch);
+        }
+
+        template <bool WithPeak>
+        __attribute__ ((target ("avx512f"), flatten))
+        KompLevels processAVX512 (const Block& block, KompDetector detector, KompState<float>* states,
+                                  const KompCoefficients& c, const KompRamps& ramps, WidestLane* scratch) noexcept
+        {
+            return processGroups<LaneOps::Lanes<16>, WithPeak> (block, detector, states, c, ramps, scratch);
+        }
+
+        __attribute__ ((target ("avx2"), flatten))
+        void processBatchAVX2 (const BatchGroup& group, const KompCoefficients& c, WidestLane* scratch) noexcept
+        {
+            processBatchGroup<LaneOps::Lanes<8>> (group, c, scratch);
+        }
+
+        __attribute__ ((target ("avx512f"), flatten))
+        void processBatchAVX512 (const BatchGroup& group, const KompCoefficients& c, WidestLane* scratch) noexcept
+        {
+            processBatchGroup<LaneOps::Lanes<16>> (group, c, scratch);
+        }
+       #endif
+
+        std::vector<Variant> findSupportedVariants()
+        {
+            std::vector<Variant> variants {
+                { "baseline", LaneOps::width<LaneOps::Vector>, 0, processBaseline<true>, processBaseline<false>, processBatchBaseline },
+                { "mono", 1, 1, processMono<true>, processMono<false> },
+                { "stereo", 2, 2, processStereo<true>, processStereo<false> },
+            };
+
+           #if PUNKKOMP_X86_DISPATCH
+            if (juce::SystemStats::hasAVX2())
+                variants.push_back ({ "avx2", 8, 0, processAVX2<true>, processAVX2<false>, processBatchAVX2 });
+
+            if (juce::SystemStats::hasAVX512F())
+                variants.push_back ({ "avx512", 16, 0, processAVX512<true>, processAVX512<false>, processBatchAVX512 });
+           #endif
+
+            return variants;
+        }
+    }
+
+    //==============================================================================
+    const std::vector<Variant>& getSupportedVariants()
+    {
+        static const auto variants = findSupportedVariants();
+        return variants;
+    }
+
+    const Variant& choose (int numChannels)
+    {
+        const auto& variants = getSupportedVariants();
+        const auto numPasses = [numChannels] (const Variant& v) { return (numChannels + v.laneWidth - 1) / v.laneWidth; };
+
+        const auto* best = &variants.front();
+
+        for (const auto& variant : variants)
+            if (variant.canProcess (numChannels)
+                && (numPasses (variant) < numPasses (*best) || (numPasses (variant) == numPasses (*best) && variant.laneWidth < best->laneWidth)))
+                best = &variant;
+
+        return *best;
+    }
+
+    const Variant& chooseBatch()
+    {
+        const auto* best = &getSupportedVariants().front();
+
+        for (const auto& variant : getSupportedVariants())
+            if (variant.processBatch != nullptr && variant.laneWidth > best->laneWidth)
+                best = &variant;
+
+        return *best;
+    }
+}
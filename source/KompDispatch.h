@@ -0,0 +1,101 @@
+#pragma once
+
+#include "KompKernel.h"
+
+//==============================================================================
+/**
+    The processKomp pass over all the channels of a block, built once per
+    instruction set. The channels are gathered into groups as wide as the
+    variant's lanes (4 for the SIMDRegister baseline, 8 for AVX2, 16 for
+    AVX-512), so a 7.1.4 block is one pass of the kernel on AVX-512. Mono and
+    stereo have variants of their own, which run the scalar kernel in place on
+    each channel in turn (linked stereo still needs the lanes, and falls back
+    to the baseline).
+
+    Every variant also comes without the voice peak filter, for the flat voice,
+    so the engine picks one of two functions whenever the layout or the voice
+    changes instead of testing per sample.
+
+    The lane variants also run KompBatch, where every lane is a mono stream with
+    ramps and a voice filter of its own rather than a channel of one block.
+
+    The baseline is whatever the plugin is compiled for. The wider variants
+    exist on x86 with GCC or Clang only: they are ordinary functions with a
+    target attribute that inline the whole kernel, so nothing outside them
+    needs the newer instructions. CPU support is checked once, the first time
+    the variants are asked for.
+
+    KompDispatch.cpp is built with -ffp-contract=off, so no variant fuses
+    multiplies and adds: they all round the same way and give bit identical
+    output.
+*/
+namespace KompDispatch
+{
+    static constexpr int maxLaneWidth = 16;
+
+    // Scratch storage for one sample of the widest variant's lanes
+    struct alignas (64) WidestLane
+    {
+        float values[maxLaneWidth];
+    };
+
+    struct Block
+    {
+        float* const* channels = nullptr;
+        const float* const* external = nullptr;   // compressed signal of the multiband mode
+        int numChannels = 0;
+        int numSamples = 0;
+    };
+
+    /** Processes the block in place. The states are per channel, and scratch has to hold
+        2 * numSamples WidestLanes.
+    */
+    using Function = KompLevels (*) (const Block&, KompDetector, KompState<float>* states,
+                                     const KompCoefficients&, const KompRamps&, WidestLane* scratch);
+
+    /** Up to one lane width of KompBatch's independent mono streams. Everything but the
+        streams is interleaved by lane: the ramps hold laneWidth floats per sample, the state
+        is a KompState of lanes, and peak is the five normalised coefficients of every lane's
+        voice filter.
+    */
+    struct BatchGroup
+    {
+        float* const* streams = nullptr;
+        int numStreams = 0;         // the lanes past it run silence
+        int numSamples = 0;
+
+        KompLaneRamps<float> ramps;
+        const float* peak = nullptr;
+        float* state = nullptr;
+        bool withPeak = true;       // false when every stream has the flat voice
+    };
+
+    /** Processes the streams in place, with the coefficients' gain curve, release and high pass.
+        scratch has to hold numSamples WidestLanes.
+    */
+    using BatchFunction = void (*) (const BatchGroup&, const KompCoefficients&, WidestLane* scratch);
+
+    struct Variant
+    {
+        const char* name;
+        int laneWidth;
+        int maxChannels;            // 0 for any channel count
+        Function process;
+        Function processFlatVoice;  // skips the peak filter
+        BatchFunction processBatch = nullptr;   // only the variants with lanes to fill have one
+
+        bool canProcess (int numChannels) const noexcept   { return maxChannels == 0 || numChannels <= maxChannels; }
+        Function get (bool withPeak) const noexcept         { return withPeak ? process : processFlatVoice; }
+    };
+
+    /** The variants this CPU can run, the baseline first. */
+    const std::vector<Variant>& getSupportedVariants();
+
+    /** The supported variant that does numChannels in the fewest passes, the narrowest one on a tie,
+        which is the mono or stereo one for those.
+    */
+    const Variant& choose (int numChannels);
+
+    /** The widest supported variant that can run a KompBatch. */
+    const Variant& chooseBatch();
+}
@@ -0,0 +1,745 @@
+#include "KompEngine.h"
+
+//==============================================================================
+void KompEngine::prepare (const juce::dsp::ProcessSpec& spec)
+{
+    jassert (spec.sampleRate > 0);
+    jassert (spec.numChannels <= (juce::uint32) maxChannels);
+
+    kernel = &KompDispatch::choose ((int) spec.numChannels);
+    updateKernelFunction();
+
+    // Hosts prepare again with the same settings on every transport start, and sessions do it for
+    // every instance: the scratch and the coefficients are still right, only the state has to go
+    if (spec == preparedSpec)
+    {
+        reset();
+        return;
+    }
+
+    preparedSpec = spec;
+    sampleRate = spec.sampleRate;
+    maximumBlockSize = (int) spec.maximumBlockSize;
+    ballistics = &resources->getBallistics (sampleRate);
+
+    // Every mode's buffers are laid out, as the mode can change without another prepare.
+    // The band output is sized for every channel the engine accepts, not just the prepared
+    // layout, so a block with more channels than announced can't run past the end.
+    const auto blockSize = (size_t) maximumBlockSize;
+    float** ramps[] = { &inputRamp, &outputRamp, &dryRamp, &wetRamp, &thresholdRamp, &attackRamp, &gateRamp, &linkedGain, &unityRamp, &fadeRamp };
+    ScratchArena::Buffer rampBuffers[std::size (ramps)];
+
+    scratch.beginLayout();
+
+    for (auto& buffer : rampBuffers)
+        buffer = scratch.reserve<float> (blockSize);
+
+    const auto laneBuffers = scratch.reserve<KompDispatch::WidestLane> (blockSize * 2);
+    const auto bandBlock = scratch.reserveBlock (maxChannels, blockSize);
+    const auto filterVoiceBlock = scratch.reserveBlock (maxChannels, blockSize);
+    const auto unlimitedBlock = scratch.reserveBlock (maxChannels, blockSize);
+
+    scratch.allocate();
+
+    for (size_t i = 0; i < std::size (ramps); ++i)
+        *ramps[i] = scratch.get<float> (rampBuffers[i]);
+
+    laneBuffer = scratch.get<KompDispatch::WidestLane> (laneBuffers);
+    bandOutput = scratch.get (bandBlock);
+    filterVoice = scratch.get (filterVoiceBlock);
+    unlimitedOutput = scratch.get (unlimitedBlock);
+    juce::FloatVectorOperations::fill (unityRamp, 1.0f, maximumBlockSize);
+
+    limiter.prepare (sampleRate, maxChannels, maximumBlockSize);
+
+    // Its frames are tens of kB per pair, so only the prepared channels get one
+    linearPhaseVoice.prepare (*resources, sampleRate, juce::jmax (1, (int) spec.numChannels));
+
+    inputGain.reset (sampleRate, gainRampSeconds);
+    outputGain.reset (sampleRate, gainRampSeconds);
+    dryVolume.reset (sampleRate, controlRampSeconds);
+    wetVolume.reset (sampleRate, controlRampSeconds);
+    voiceMorphPosition.reset (sampleRate, controlRampSeconds);
+    linearPhaseMix.reset (sampleRate, controlRampSeconds);
+    limiterMix.reset (sampleRate, controlRampSeconds);
+
+    // Threshold moves are exponential (linear in dB), the attack coefficient moves linearly
+    thresholdInverse.reset (sampleRate, controlRampSeconds);
+    gateThreshold.reset (sampleRate, controlRampSeconds);
+    attack.reset (sampleRate, controlRampSeconds);
+    attack.setCurrentAndTargetValue (calculateBallistics (attackMs));
+
+    updateCompressor();
+    reset();
+}
+
+void KompEngine::reset()
+{
+    for (auto& state : states)
+        state.reset();
+
+    linkedEnvelope = 0.0f;
+
+    for (auto& state : bandStates)
+        state.reset();
+
+    linkedBandEnvelope = {};
+    bandGain = bandCoefficients.gain;
+
+    // A voice mode built since the last block starts here, with no crossfade, so the latency is right straight away
+    linearPhaseVoiceActive = false;
+    updateVoiceModes();
+    linearPhaseFill = 0;
+    updateVoiceFilter();
+
+    // The limiter as well, if it's on
+    limiterActive = false;
+    updateLimiter();
+    limiterFill = 0;
+
+    limiter.reset();
+    linearPhaseVoice.reset();
+
+    for (auto* value : { &inputGain, &outputGain, &dryVolume, &wetVolume, &attack, &voiceMorphPosition, &linearPhaseMix, &limiterMix })
+        value->setCurrentAndTargetValue (value->getTargetValue());
+
+    voiceMorphApplied = -1.0f;
+
+    thresholdInverse.setCurrentAndTargetValue (thresholdInverse.getTargetValue());
+    gateThreshold.setCurrentAndTargetValue (gateThreshold.getTargetValue());
+}
+
+//==============================================================================
+void KompEngine::setInputGainDecibels (float newGainDecibels)
+{
+    inputGain.setTargetValue (juce::Decibels::decibelsToGain (newGainDecibels));
+}
+
+void KompEngine::setOutputGainDecibels (float newGainDecibels)
+{
+    outputGain.setTargetValue (juce::Decibels::decibelsToGain (newGainDecibels));
+}
+
+void KompEngine::setMix (float newWetProportion)
+{
+    const auto mix = juce::jlimit (0.0f, 1.0f, newWetProportion);
+
+    dryVolume.setTargetValue (1.0f - mix);
+    wetVolume.setTargetValue (mix);
+}
+
+void KompEngine::setThreshold (float newThresholdDecibels)
+{
+    if (! juce::exactlyEqual (thresholdDecibels, newThresholdDecibels))
+    {
+        thresholdDecibels = newThresholdDecibels;
+        thresholdInverse.setTargetValue (1.0f / juce::Decibels::decibelsToGain (thresholdDecibels, -200.0f));
+    }
+}
+
+void KompEngine::setRatio (float newRatio)
+{
+    jassert (newRatio >= 1.0f);
+
+    if (! juce::exactlyEqual (ratio, newRatio))
+    {
+        ratio = newRatio;
+        updateCompressor();
+    }
+}
+
+void KompEngine::setAttack (float newAttackMs)
+{
+    if (! juce::exactlyEqual (attackMs, newAttackMs))
+    {
+        attackMs = newAttackMs;
+        attack.setTargetValue (calculateBallistics (attackMs));
+    }
+}
+
+void KompEngine::setRelease (float newReleaseMs)
+{
+    if (! juce::exactlyEqual (releaseMs, newReleaseMs))
+    {
+        releaseMs = newReleaseMs;
+        updateCompressor();
+    }
+}
+
+void KompEngine::setLinked (bool shouldBeLinked)
+{
+    if (linked != shouldBeLinked)
+    {
+        // Start the new detector from where the old one was
+        linkedEnvelope = 0.0f;
+
+        for (auto& state : states)
+            linkedEnvelope = juce::jmax (linkedEnvelope, state.envelope);
+
+        for (auto& state : states)
+            state.envelope = linkedEnvelope;
+
+        linkedBandEnvelope = {};
+
+        for (auto& state : bandStates)
+            linkedBandEnvelope = LaneOps::max (linkedBandEnvelope, state.envelope);
+
+        for (auto& state : bandStates)
+            state.envelope = linkedBandEnvelope;
+
+        linked = shouldBeLinked;
+    }
+}
+
+void KompEngine::setGateEnabled (bool shouldBeEnabled)
+{
+    if (gateEnabled != shouldBeEnabled)
+    {
+        gateEnabled = shouldBeEnabled;
+        updateGate();
+    }
+}
+
+void KompEngine::setGateThreshold (float newThresholdDecibels)
+{
+    if (! juce::exactlyEqual (gateThresholdDecibels, newThresholdDecibels))
+    {
+        gateThresholdDecibels = newThresholdDecibels;
+        gateThreshold.setTargetValue (juce::Decibels::decibelsToGain (gateThresholdDecibels, -200.0f));
+    }
+}
+
+void KompEngine::setGateRatio (float newRatio)
+{
+    jassert (newRatio >= 1.0f);
+
+    if (! juce::exactlyEqual (gateRatio, newRatio))
+    {
+        gateRatio = newRatio;
+        gateCurve = gateRatio > 1.0f ? &resources->getGainCurve (1.0f - gateRatio) : nullptr;
+        updateGate();
+    }
+}
+
+void KompEngine::setNumBands (int newNumBands)
+{
+    newNumBands = juce::jlimit (1, maxBands, newNumBands);
+
+    if (numBands != newNumBands)
+    {
+        // The crossover and detector states belong to the old split
+        for (auto& state : bandStates)
+            state.reset();
+
+        linkedBandEnvelope = {};
+        numBands = newNumBands;
+        updateBands();
+        bandGain = bandCoefficients.gain;
+    }
+}
+
+void KompEngine::setCrossoverFrequencies (float newLowHz, float newHighHz)
+{
+    if (! juce::exactlyEqual (crossoverLowHz, newLowHz) || ! juce::exactlyEqual (crossoverHighHz, newHighHz))
+    {
+        crossoverLowHz = newLowHz;
+        crossoverHighHz = newHighHz;
+        updateBands();
+    }
+}
+
+void KompEngine::setBandOffsets (int band, float inputGainDecibels, float thresholdDecibels)
+{
+    jassert (juce::isPositiveAndBelow (band, maxBands));
+
+    auto& input = bandInputDecibels[(size_t) band];
+    auto& threshold = bandThresholdDecibels[(size_t) band];
+
+    if (! juce::exactlyEqual (input, inputGainDecibels) || ! juce::exactlyEqual (threshold, thresholdDecibels))
+    {
+        input = inputGainDecibels;
+        threshold = thresholdDecibels;
+        updateBands();
+    }
+}
+
+void KompEngine::setPeakCoefficients (const std::array<float, 6>& newCoefficients)
+{
+    normaliseBiquad (newCoefficients, switchPeak);
+    switchPeakIsFlat = isIdentityBiquad (newCoefficients);
+
+    if (! isVoiceMorphPlaying())
+        setPeak (switchPeak, switchPeakIsFlat);
+}
+
+void KompEngine::setVoiceMorphTable (const VoiceMorphTable& newTable) noexcept
+{
+    voiceMorph = &newTable;
+    voiceMorphApplied = -1.0f;
+}
+
+void KompEngine::setVoiceMorphEnabled (bool shouldBeEnabled)
+{
+    jassert (voiceMorph != nullptr || ! shouldBeEnabled);
+    shouldBeEnabled = shouldBeEnabled && voiceMorph != nullptr;
+
+    if (voiceMorphEnabled != shouldBeEnabled)
+    {
+        voiceMorphEnabled = shouldBeEnabled;
+        updateVoiceFilter();
+    }
+}
+
+void KompEngine::setVoiceMorphPosition (float newPosition)
+{
+    voiceMorphPosition.setTargetValue (juce::jlimit (0.0f, VoiceMorphTable::maxPosition, newPosition));
+}
+
+void KompEngine::updateVoiceModes() noexcept
+{
+    // The filter voice stands in until it's built
+    const auto linearPhase = isLinearPhaseVoiceEnabled() && linearPhaseVoice.isReady();
+    linearPhaseMix.setTargetValue (linearPhase ? 1.0f : 0.0f);
+
+    if (linearPhase && ! linearPhaseVoiceActive)
+    {
+        // It holds whatever it last ran on, so it starts from silence and the filter voice plays on until it's through
+        linearPhaseVoice.reset();
+        linearPhaseFill = linearPhaseVoice.getLatencySamples();
+        linearPhaseVoiceActive = true;
+        updateVoiceFilter();
+    }
+    else if (! linearPhase && linearPhaseVoiceActive && linearPhaseFill > 0)
+    {
+        // Nothing of it was heard yet, there's nothing to fade
+        stopLinearPhaseVoice();
+    }
+}
+
+void KompEngine::stopLinearPhaseVoice() noexcept
+{
+    linearPhaseVoiceActive = false;
+    linearPhaseFill = 0;
+    linearPhaseMix.setCurrentAndTargetValue (0.0f);
+    updateVoiceFilter();
+}
+
+void KompEngine::updateVoiceFilter() noexcept
+{
+    // Whichever takes over does so on the next sample, the morph with the next block. The linear
+    // phase voice undoes the switch's filter, so that one plays under it.
+    if (isVoiceMorphPlaying())
+    {
+        voiceMorphApplied = -1.0f;
+    }
+    else
+    {
+        setPeak (switchPeak, switchPeakIsFlat);
+    }
+}
+
+void KompEngine::setPeak (const float* normalisedCoefficients, bool isFlat) noexcept
+{
+    // An identity biquad's state stays at zero, so that's where a skipped one restarts from
+    if (peakIsFlat && ! isFlat)
+        for (auto& state : states)
+            state.peak[0] = state.peak[1] = 0.0f;
+
+    peakIsFlat = isFlat;
+    std::copy (normalisedCoefficients, normalisedCoefficients + 5, coefficients.peak);
+    updateKernelFunction();
+}
+
+void KompEngine::updateVoiceMorph (int numSamples) noexcept
+{
+    // One set of coefficients per block, at the position the block ends on
+    const auto position = voiceMorphPosition.skip (numSamples);
+
+    if (isVoiceMorphPlaying() && ! juce::exactlyEqual (position, voiceMorphApplied))
+    {
+        float peak[5];
+        voiceMorph->getCoefficients (position, peak);
+        setPeak (peak, isIdentityBiquad (peak));
+
+        voiceMorphApplied = position;
+    }
+}
+
+void KompEngine::setHighPassCoefficients (const std::array<float, 6>& newCoefficients)
+{
+    normaliseBiquad (newCoefficients, coefficients.highPass);
+}
+
+//==============================================================================
+void KompEngine::updateCompressor()
+{
+    // Only the ratio changes the curve, so the shared table is not looked up again on threshold or attack moves
+    const auto exponent = 1.0f / ratio - 1.0f;
+
+    if (coefficients.gainCurve == nullptr || ! juce::exactlyEqual (coefficients.gainCurve->getExponent(), exponent))
+        coefficients.gainCurve = &resources->getGainCurve (exponent);
+
+    coefficients.release = calculateBallistics (releaseMs);
+
+    updateBands();
+}
+
+void KompEngine::updateBands()
+{
+    auto& c = bandCoefficients;
+
+    c.release = coefficients.release;
+    c.gainCurve = coefficients.gainCurve;
+    c.gainSmoothing = static_cast<float> (std::exp (-1.0 / (0.05 * sampleRate)));
+
+    const auto setCutoff = [this] (BandCrossover& crossover, float frequency)
+    {
+        const auto limited = juce::jlimit (20.0, 0.45 * sampleRate, (double) frequency);
+        const auto g = static_cast<float> (std::tan (juce::MathConstants<double>::pi * limited / sampleRate));
+        const auto r2 = static_cast<float> (std::sqrt (2.0));
+
+        crossover.g = g;
+        crossover.h = static_cast<float> (1.0 / (1.0 + r2 * g + g * g));
+        crossover.r2PlusG = r2 + g;
+    };
+
+    setCutoff (c.crossovers[0], crossoverLowHz);
+    setCutoff (c.crossovers[1], crossoverHighHz);
+    c.numStages = numBands > 2 ? 2 : 1;
+    c.numBands = numBands;
+
+    for (auto& crossover : c.crossovers)
+        crossover.lowWeight = crossover.highWeight = 0.0f;
+
+    // Stage 1: {low, high, high}, stage 2: {allpass, low, high}
+    c.crossovers[0].lowWeight.set (0, 1.0f);
+
+    for (size_t band = 1; band < (size_t) numBands; ++band)
+        c.crossovers[0].highWeight.set (band, 1.0f);
+
+    c.crossovers[1].lowWeight.set (0, 1.0f);
+    c.crossovers[1].highWeight.set (0, 1.0f);
+    c.crossovers[1].lowWeight.set (1, 1.0f);
+    c.crossovers[1].highWeight.set (2, 1.0f);
+
+    c.thresholdOffset = 1.0f;
+    c.gain = 0.0f;
+
+    for (size_t band = 0; band < (size_t) numBands; ++band)
+    {
+        c.thresholdOffset.set (band, juce::Decibels::decibelsToGain (-bandThresholdDecibels[band]));
+        c.gain.set (band, juce::Decibels::decibelsToGain (bandInputDecibels[band]));
+    }
+}
+
+void KompEngine::updateGate() noexcept
+{
+    // A null curve is what turns the gate off in the kernels
+    coefficients.gateCurve = bandCoefficients.gateCurve = gateEnabled ? gateCurve : nullptr;
+}
+
+float KompEngine::calculateBallistics (float timeMs) const
+{
+    // Attack moves on the audio thread are table lookups once prepared
+    return ballistics != nullptr ? (*ballistics) (timeMs)
+                                 : BallisticsTable::calculate (sampleRate, timeMs);
+}
+
+void KompEngine::setKernelVariant (const KompDispatch::Variant& newVariant) noexcept
+{
+    kernel = &newVariant;
+    updateKernelFunction();
+}
+
+void KompEngine::updateKernelFunction() noexcept
+{
+    kernelFunction = kernel->get (! peakIsFlat);
+}
+
+//==============================================================================
+KompRamps KompEngine::fillRamps (int numSamples)
+{
+    // A step per sample (an add, or a multiply for the threshold) while moving, a plain fill otherwise
+    const auto fill = [numSamples] (auto& value, float* ramp)
+    {
+        if (value.isSmoothing())
+        {
+            for (int i = 0; i < numSamples; ++i)
+                ramp[i] = value.getNextValue();
+        }
+        else
+        {
+            juce::FloatVectorOperations::fill (ramp, value.getTargetValue(), numSamples);
+        }
+    };
+
+    fill (inputGain, inputRamp);
+    fill (outputGain, outputRamp);
+    fill (dryVolume, dryRamp);
+    fill (wetVolume, wetRamp);
+    fill (thresholdInverse, thresholdRamp);
+    fill (attack, attackRamp);
+
+    // The gate threshold is scaled by the input gain, as the envelope it is compared with is
+    if (coefficients.gateCurve != nullptr)
+    {
+        fill (gateThreshold, gateRamp);
+        juce::FloatVectorOperations::multiply (gateRamp, inputRamp, numSamples);
+    }
+    else
+    {
+        gateThreshold.skip (numSamples);
+    }
+
+    // The limiter applies the output gain while it runs
+    return { inputRamp, dryRamp, wetRamp, limiterActive ? unityRamp : outputRamp, thresholdRamp, attackRamp, gateRamp, linkedGain };
+}
+
+void KompEngine::computeLinkedGain (const juce::dsp::AudioBlock<float>& block)
+{
+    const auto numChannels = (int) block.getNumChannels();
+    const auto numSamples = (int) block.getNumSamples();
+
+    const auto release = coefficients.release;
+    auto envelope = linkedEnvelope;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // |x * g| == |x| * g for the positive input gain, so the loudest channel can be picked before the gain
+        auto peak = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            peak = juce::jmax (peak, std::abs (block.getSample (ch, i)));
+
+        const auto level = peak * inputRamp[i];
+        envelope = level + (level > envelope ? attackRamp[i] : release) * (envelope - level);
+        linkedGain[i] = LaneOps::compressorGain (envelope, thresholdRamp[i], *coefficients.gainCurve);
+
+        if (coefficients.gateCurve != nullptr)
+            linkedGain[i] *= LaneOps::expanderGain (envelope, gateRamp[i], *coefficients.gateCurve);
+    }
+
+    linkedEnvelope = envelope;
+}
+
+void KompEngine::computeBands (const juce::dsp::AudioBlock<float>& block, const KompRamps& ramps)
+{
+    const auto numChannels = (int) block.getNumChannels();
+    const auto numSamples = (int) block.getNumSamples();
+
+    const float* inputs[maxChannels];
+    float* outputs[maxChannels];
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        inputs[ch] = block.getChannelPointer ((size_t) ch);
+        outputs[ch] = bandOutput.getChannelPointer ((size_t) ch);
+    }
+
+    if (linked)
+        processBands<true> (inputs, outputs, numChannels, numSamples, bandStates.data(), linkedBandEnvelope, bandGain, bandScratch.data(), bandCoefficients, ramps);
+    else
+        processBands<false> (inputs, outputs, numChannels, numSamples, bandStates.data(), linkedBandEnvelope, bandGain, bandScratch.data(), bandCoefficients, ramps);
+}
+
+//==============================================================================
+KompEngine::Levels KompEngine::process (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert (maximumBlockSize > 0);    // not prepared
+
+    const auto numSamples = block.getNumSamples();
+
+    // A moving voice morph gets a new filter every chunk, so its chunks are short
+    const auto morphIsMoving = isVoiceMorphPlaying() && voiceMorphPosition.isSmoothing();
+    const auto chunkSize = (size_t) (morphIsMoving ? juce::jmin (maximumBlockSize, voiceMorphInterval) : maximumBlockSize);
+
+    if (numSamples <= chunkSize)
+        return processChunk (block);
+
+    // Some hosts send more than they announced in prepareToPlay when bouncing offline.
+    // Running the scratch buffers several times is the same as one long pass, every state is per sample.
+    Levels levels;
+
+    for (size_t start = 0; start < numSamples && chunkSize > 0; start += chunkSize)
+    {
+        const auto chunk = processChunk (block.getSubBlock (start, juce::jmin (chunkSize, numSamples - start)));
+
+        levels.input = juce::jmax (levels.input, chunk.input);
+        levels.compressed = juce::jmax (levels.compressed, chunk.compressed);
+    }
+
+    return levels;
+}
+
+void KompEngine::processBypassed (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    // The voice modes and the limiter are followed here too, so the latency is the same as when switched on
+    updateVoiceModes();
+    updateLimiter();
+
+    const auto chunkSize = (size_t) maximumBlockSize;
+
+    for (size_t start = 0; start < block.getNumSamples() && chunkSize > 0; start += chunkSize)
+    {
+        const auto chunk = block.getSubBlock (start, juce::jmin (chunkSize, block.getNumSamples() - start));
+
+        processLinearPhaseVoice (chunk, false);
+        processLimiter (chunk, false);
+    }
+}
+
+void KompEngine::processLinearPhaseVoice (const juce::dsp::AudioBlock<float>& block, bool convolve) noexcept
+{
+    if (! linearPhaseVoiceActive)
+        return;
+
+    const auto run = [this, &block, convolve]
+    {
+        if (convolve)
+            linearPhaseVoice.process (block);
+        else
+            linearPhaseVoice.processDelayOnly (block);
+    };
+
+    if (linearPhaseFill == 0 && ! linearPhaseMix.isSmoothing())
+    {
+        run();
+        return;
+    }
+
+    // The filter voice goes in and is kept to fade from or to. The two are a latency apart,
+    // which the host makes up for once it has the new one.
+    const auto numSamples = (int) block.getNumSamples();
+    const auto filtered = filterVoice.getSubsetChannelBlock (0, block.getNumChannels()).getSubBlock (0, (size_t) numSamples);
+    filtered.copyFrom (block);
+    run();
+    crossfade (block, filtered, linearPhaseFill, linearPhaseMix);
+
+    if (! linearPhaseMix.isSmoothing() && juce::exactlyEqual (linearPhaseMix.getTargetValue(), 0.0f))
+        stopLinearPhaseVoice();
+}
+
+void KompEngine::updateLimiter() noexcept
+{
+    const auto enabled = isLimiterEnabled();
+    limiterMix.setTargetValue (enabled ? 1.0f : 0.0f);
+
+    if (enabled && ! limiterActive)
+    {
+        // Its delay starts out silent, so the output without it plays on until it's through
+        limiter.reset();
+        limiterFill = limiter.getLatencySamples();
+        limiterActive = true;
+    }
+    else if (! enabled && limiterActive && limiterFill > 0)
+    {
+        // Nothing of it was heard yet, there's nothing to fade
+        stopLimiter();
+    }
+}
+
+void KompEngine::stopLimiter() noexcept
+{
+    limiterActive = false;
+    limiterFill = 0;
+    limiterMix.setCurrentAndTargetValue (0.0f);
+}
+
+void KompEngine::processLimiter (const juce::dsp::AudioBlock<float>& block, bool limit) noexcept
+{
+    if (! limiterActive)
+        return;
+
+    const auto run = [this, &block, limit]
+    {
+        if (limit)
+            limiter.process (block, outputRamp);
+        else
+            limiter.processDelayOnly (block);
+    };
+
+    if (limiterFill == 0 && ! limiterMix.isSmoothing())
+    {
+        run();
+        return;
+    }
+
+    // The output without it is kept to fade from or to, at the output gain the kernel left out
+    const auto numSamples = (int) block.getNumSamples();
+    const auto unlimited = unlimitedOutput.getSubsetChannelBlock (0, block.getNumChannels()).getSubBlock (0, (size_t) numSamples);
+    unlimited.copyFrom (block);
+
+    if (limit)
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::multiply (unlimited.getChannelPointer (ch), outputRamp, numSamples);
+
+    run();
+    crossfade (block, unlimited, limiterFill, limiterMix);
+
+    if (! limiterMix.isSmoothing() && juce::exactlyEqual (limiterMix.getTargetValue(), 0.0f))
+        stopLimiter();
+}
+
+void KompEngine::crossfade (const juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<float>& from,
+                            int& fill, juce::SmoothedValue<float>& mix) noexcept
+{
+    // from plays alone while the block's output fills, then mix takes it over to the block
+    const auto numSamples = (int) block.getNumSamples();
+
+    for (int i = 0; i < numSamples; ++i)
+        fadeRamp[i] = i < fill ? 0.0f : mix.getNextValue();
+
+    fill = juce::jmax (0, fill - numSamples);
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        auto* out = block.getChannelPointer (ch);
+        const auto* in = from.getChannelPointer (ch);
+
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = in[i] + fadeRamp[i] * (out[i] - in[i]);
+    }
+}
+
+KompEngine::Levels KompEngine::processChunk (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto numChannels = (int) block.getNumChannels();
+    const auto numSamples = (int) block.getNumSamples();
+
+    jassert (numChannels <= maxChannels);
+    jassert (numSamples <= maximumBlockSize);
+
+    updateVoiceModes();
+    updateLimiter();
+
+    if (voiceMorphEnabled)
+        updateVoiceMorph (numSamples);
+
+    const auto ramps = fillRamps (numSamples);
+
+    if (numBands > 1)
+        computeBands (block, ramps);
+    else if (linked)
+        computeLinkedGain (block);
+
+    float* channels[maxChannels];
+    const float* external[maxChannels];
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        channels[ch] = block.getChannelPointer ((size_t) ch);
+        external[ch] = bandOutput.getChannelPointer ((size_t) ch);
+    }
+
+    const auto detector = numBands > 1 ? KompDetector::external
+                        : linked       ? KompDetector::linked
+                                       : KompDetector::perLane;
+
+    jassert (kernel->canProcess (numChannels));
+    const auto levels = kernelFunction ({ channels, external, numChannels, numSamples }, detector, states.data(), coefficients, ramps, laneBuffer);
+
+    processLinearPhaseVoice (block, true);
+    processLimiter (block, true);
+
+    return levels;
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "BandKernel.h"
+#include "DspResources.h"
+#include "KompDispatch.h"
+#include "LinearPhaseVoice.h"
+#include "SafetyLimiter.h"
+#include "ScratchArena.h"
+
+//==============================================================================
+/**
+    Runs the PunkKomp chain on up to maxChannels channels.
+
+    Channels are processed in groups, one channel per lane, by the widest
+    kernel variant the CPU supports that the channel count can use (see
+    KompDispatch), so a 7.1.4 block costs three passes of the kernel on SSE,
+    or one on AVX-512, rather than twelve. The detector either follows each
+    channel on its own or is linked, in which case it runs once on the loudest
+    channel and the same gain is applied to all of them.
+
+    The optional gate is a downward expander on the compressor's own envelope
+    (per channel, linked or per band, like the compressor), whose gain goes
+    into the same multiply as the compressor's.
+
+    In the 2 and 3 band modes the compressor is replaced by the BandKernel
+    front end (crossovers plus one detector per band), and the bands are summed
+    before the mix and voice stages.
+
+    The linear phase voice mode adds a LinearPhaseVoice on the kernel's
+    output, which undoes the switch's voice filter's phase. The high pass the
+    kernel applies after the voice is linear, so running it after that is the
+    same chain. The filter voice is its input, so switching crossfades between the
+    two: it fills for its latency, then takes over over controlRampSeconds,
+    and hands back the same way. Dry and wet are mixed before the voice, so
+    its delay moves both together.
+
+    The SafetyLimiter comes last, and only runs while it's enabled, so that's
+    the only time its lookahead is in the latency. It switches the way the
+    linear phase voice does, with the output it delays and limits filling and
+    fading over from the output without it. While it runs the kernel leaves
+    the output gain out and the limiter applies it along with its own gain,
+    still one multiply per sample.
+*/
+class KompEngine
+{
+public:
+    static constexpr int maxChannels = 16;
+    static constexpr int maxBands = 3;
+
+    // Ramp lengths, the same as the juce::dsp::Gain and DryWetMixer stages the engine replaces
+    static constexpr double gainRampSeconds = 0.1;      // input and output gain
+    static constexpr double controlRampSeconds = 0.05;  // mix, thresholds, attack and voice morph
+
+    static constexpr int voiceMorphInterval = 32;
+
+    //==============================================================================
+    /** Preparing again with the same spec only resets, nothing is rebuilt or allocated. */
+    void prepare (const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    //==============================================================================
+    // Gains, mix, threshold and attack are ramped per sample towards the new value.
+    // The threshold ramps in dB and the attack coefficient ramps linearly, so a move
+    // costs one multiply or add per sample instead of recomputing the coefficients.
+    void setInputGainDecibels (float newGainDecibels);
+    void setOutputGainDecibels (float newGainDecibels);
+    void setMix (float newWetProportion);
+
+    void setThreshold (float newThresholdDecibels);
+
+    /** Takes a lock on the shared gain curve tables, so set it from prepareToPlay. */
+    void setRatio (float newRatio);
+    void setAttack (float newAttackMs);
+    void setRelease (float newReleaseMs);
+    void setLinked (bool shouldBeLinked);
+
+    /** Off by default. The gate threshold is on the input's scale, before the input gain,
+        so turning the input up doesn't open the gate on the noise floor.
+    */
+    void setGateEnabled (bool shouldBeEnabled);
+    void setGateThreshold (float newThresholdDecibels);
+
+    /** 1:newRatio below the gate threshold. Takes a lock on the shared gain curve tables, so set it from prepareToPlay. */
+    void setGateRatio (float newRatio);
+
+    /** 1 for the plain compressor, 2 or 3 to split at the crossover frequencies. */
+    void setNumBands (int newNumBands);
+    void setCrossoverFrequencies (float newLowHz, float newHighHz);
+
+    /** Offsets on top of the input gain and threshold for one band, band 0 being the lowest. */
+    void setBandOffsets (int band, float inputGainDecibels, float thresholdDecibels);
+
+    void setPeakCoefficients (const std::array<float, 6>& newCoefficients);
+
+    /** The morph table for the prepared sample rate, which setVoiceMorphEnabled needs. Set it from prepareToPlay. */
+    void setVoiceMorphTable (const VoiceMorphTable& newTable) noexcept;
+
+    /** While enabled, the voice filter comes from the morph table instead of setPeakCoefficients.
+        The position ramps like the other controls, and the filter follows it every
+        voiceMorphInterval samples at least.
+    */
+    void setVoiceMorphEnabled (bool shouldBeEnabled);
+    void setVoiceMorphPosition (float newPosition);
+
+    /** Off by default. While enabled, the voice is the switch's in linear phase, whether the morph
+        is on or not. It comes in from the first block after
+        prepareLinearPhaseVoice has run. The latency moves with it, so it may be set from the
+        thread that reports the latency (the message thread) while process runs.
+    */
+    void setLinearPhaseVoiceEnabled (bool shouldBeEnabled) noexcept { linearPhaseVoiceEnabled.store (shouldBeEnabled, std::memory_order_relaxed); }
+    bool isLinearPhaseVoiceEnabled() const noexcept                 { return linearPhaseVoiceEnabled.load (std::memory_order_relaxed); }
+    void setLinearPhaseVoice (int newVoice) noexcept                { linearPhaseVoice.setVoice (newVoice); }
+
+    /** Lays out its buffers, once, after the first prepare. It allocates, so it belongs on the
+        message thread (or in an offline render), but process can run meanwhile.
+    */
+    void prepareLinearPhaseVoice()                                  { linearPhaseVoice.build(); }
+    bool isLinearPhaseVoiceReady() const noexcept                   { return linearPhaseVoice.isReady(); }
+    void setHighPassCoefficients (const std::array<float, 6>& newCoefficients);
+
+    /** Off by default. The limiter comes in from the next block, and like the linear phase voice
+        it moves the latency, so it may be set from the thread that reports it while process runs.
+    */
+    void setLimiterEnabled (bool shouldBeEnabled) noexcept          { limiterEnabled.store (shouldBeEnabled, std::memory_order_relaxed); }
+    bool isLimiterEnabled() const noexcept                          { return limiterEnabled.load (std::memory_order_relaxed); }
+    void setLimiterCeiling (float newCeilingDecibels) noexcept     { limiter.setCeiling (newCeilingDecibels); }
+
+    /** The limiter's lookahead while it's enabled, and the linear phase voice's delay once it's
+        enabled and built. It changes as soon as either switch does, the audio follows after the
+        crossfade. Safe to call from any thread, while the linear phase voice is being built too.
+    */
+    int getLatencySamples() const noexcept
+    {
+        return (isLimiterEnabled() ? limiter.getLatencySamples() : 0)
+             + (isLinearPhaseVoiceEnabled() ? linearPhaseVoice.getLatencySamples() : 0);
+    }
+
+    /** prepare picks the kernel variant for the channel count, this overrides it (for benchmarks). */
+    void setKernelVariant (const KompDispatch::Variant& newVariant) noexcept;
+    const KompDispatch::Variant& getKernelVariant() const noexcept              { return *kernel; }
+
+    /** The working memory prepare set aside, which process never adds to. */
+    size_t getScratchBytes() const noexcept
+    {
+        return scratch.getNumBytes() + limiter.getScratchBytes() + linearPhaseVoice.getScratchBytes();
+    }
+
+    //==============================================================================
+    using Levels = KompLevels;
+
+    /** Processes the block in place. Blocks longer than the prepared maximum block size
+        are run in pieces of that size, without allocating.
+    */
+    Levels process (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    /** For a switched off engine: delays the block by getLatencySamples() and does nothing else,
+        so switching off doesn't move the audio in time.
+    */
+    void processBypassed (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+    void updateCompressor();
+    void updateBands();
+    void updateGate() noexcept;
+    void setPeak (const float* normalisedCoefficients, bool isFlat) noexcept;
+    void updateVoiceModes() noexcept;
+    void updateVoiceFilter() noexcept;
+    bool isVoiceMorphPlaying() const noexcept       { return voiceMorphEnabled && ! linearPhaseVoiceActive; }
+    void processLinearPhaseVoice (const juce::dsp::AudioBlock<float>& block, bool convolve) noexcept;
+    void stopLinearPhaseVoice() noexcept;
+    void updateLimiter() noexcept;
+    void processLimiter (const juce::dsp::AudioBlock<float>& block, bool limit) noexcept;
+    void stopLimiter() noexcept;
+    void crossfade (const juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<float>& from, int& fill, juce::SmoothedValue<float>& mix) noexcept;
+    void updateVoiceMorph (int numSamples) noexcept;
+    void computeBands (const juce::dsp::AudioBlock<float>& block, const KompRamps& ramps);
+    Levels processChunk (const juce::dsp::AudioBlock<float>& block) noexcept;
+    float calculateBallistics (float timeMs) const;
+    KompRamps fillRamps (int numSamples);
+    void updateKernelFunction() noexcept;
+    void computeLinkedGain (const juce::dsp::AudioBlock<float>& block);
+
+    //==============================================================================
+    juce::SharedResourcePointer<DspResources> resources;
+    const BallisticsTable* ballistics = nullptr;
+
+    juce::dsp::ProcessSpec preparedSpec {};
+    double sampleRate = 44100.0;
+    int maximumBlockSize = 0;
+
+    float thresholdDecibels = 0.0f, ratio = 4.0f, attackMs = 1.0f, releaseMs = 100.0f;
+    bool linked = false;
+
+    float gateThresholdDecibels = -100.0f, gateRatio = 1.0f;
+    bool gateEnabled = false;
+    const GainCurveTable* gateCurve = nullptr;     // for the ratio, whether the gate is on or not
+
+    const KompDispatch::Variant* kernel = &KompDispatch::getSupportedVariants().front();
+    KompDispatch::Function kernelFunction = kernel->process;
+    bool peakIsFlat = false;    // the voice filter is an identity and gets skipped
+
+    // The switch's voice filter, kept while the morph replaces it
+    float switchPeak[5] { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    bool switchPeakIsFlat = true;
+
+    const VoiceMorphTable* voiceMorph = nullptr;
+    bool voiceMorphEnabled = false;
+    float voiceMorphApplied = -1.0f;    // the position the voice filter was made for
+
+    LinearPhaseVoice linearPhaseVoice;
+    std::atomic<bool> linearPhaseVoiceEnabled { false };
+    bool linearPhaseVoiceActive = false;    // running, fading in or out
+    int linearPhaseFill = 0;                // samples before its output comes through
+    juce::SmoothedValue<float> linearPhaseMix;
+
+    KompCoefficients coefficients;
+    std::array<KompState<float>, maxChannels> states;
+    float linkedEnvelope = 0.0f;
+
+    int numBands = 1;
+    float crossoverLowHz = 200.0f, crossoverHighHz = 3000.0f;
+    std::array<float, maxBands> bandInputDecibels {}, bandThresholdDecibels {};
+
+    BandCoefficients bandCoefficients;
+    std::array<BandState, maxChannels> bandStates;
+    std::array<BandVector, maxChannels> bandScratch;
+    BandVector linkedBandEnvelope {}, bandGain {};
+
+    juce::SmoothedValue<float> inputGain, outputGain, dryVolume, wetVolume, attack, voiceMorphPosition;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> thresholdInverse { 1.0f }, gateThreshold { 1.0e-5f };
+
+    // Every buffer below lives in the arena, laid out by prepare
+    ScratchArena scratch;
+    float* inputRamp = nullptr;
+    float* outputRamp = nullptr;
+    float* dryRamp = nullptr;
+    float* wetRamp = nullptr;
+    float* thresholdRamp = nullptr;
+    float* attackRamp = nullptr;
+    float* gateRamp = nullptr;
+    float* linkedGain = nullptr;
+    float* unityRamp = nullptr;                         // the kernel's output gain while the limiter applies it
+    float* fadeRamp = nullptr;                          // the linear phase voice's and the limiter's crossfades
+    KompDispatch::WidestLane* laneBuffer = nullptr;     // kernel scratch, samples then the external detector
+    juce::dsp::AudioBlock<float> bandOutput;            // compressed signal of the multiband mode
+    juce::dsp::AudioBlock<float> filterVoice;           // what the linear phase voice fades from or to
+    juce::dsp::AudioBlock<float> unlimitedOutput;       // what the limiter fades from or to
+
+    SafetyLimiter limiter;
+    std::atomic<bool> limiterEnabled { false };
+    bool limiterActive = false;         // running, fading in or out
+    int limiterFill = 0;                // samples before its output comes through
+    juce::SmoothedValue<float> limiterMix;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "LaneOps.h"
+
+struct KompCoefficients
+{
+    // Compressor, threshold and attack come in as ramps
+    const GainCurveTable* gainCurve = nullptr;    // pow (x, 1 / ratio - 1)
+    float release = 0.0f;       // ballistics filter coefficient
+
+    // Expander below the gate threshold, on the same envelope. nullptr while the gate is off.
+    const GainCurveTable* gateCurve = nullptr;    // pow (x, 1 - gate ratio)
+
+    // Normalised biquads, {b0, b1, b2, a1, a2}
+    float peak[5] { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    float highPass[5] { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+// Per-sample control values, shared by all the lanes
+struct KompRamps
+{
+    const float* input = nullptr;
+    const float* dry = nullptr;
+    const float* wet = nullptr;
+    const float* output = nullptr;
+
+    // Compressor
+    const float* thresholdInverse = nullptr;
+    const float* attack = nullptr;      // ballistics filter coefficient
+    const float* gateThreshold = nullptr;   // on the envelope's scale, i.e. after the input gain
+
+    // Detector gain computed over all channels, only used in linked mode
+    const float* linkedGain = nullptr;
+};
+
+struct KompLevels
+{
+    float input = 0.0f;         // peak after the input gain
+    float compressed = 0.0f;    // peak after the compressor
+};
+
+template <typename Lane>
+struct KompState
+{
+    Lane envelope {};
+    Lane peak[2] {};
+    Lane highPass[2] {};
+
+    // Peak levels after the input gain and after the compressor since the last reset
+    Lane inputLevel {};
+    Lane compressedLevel {};
+
+    void reset() noexcept { *this = {}; }
+};
+
+// Per-sample control values with a value per lane, for lanes that each run a stream of their own (KompBatch)
+template <typename Lane>
+struct KompLaneRamps
+{
+    const Lane* input = nullptr;
+    const Lane* dry = nullptr;
+    const Lane* wet = nullptr;
+    const Lane* output = nullptr;
+    const Lane* thresholdInverse = nullptr;
+    const Lane* attack = nullptr;
+    const Lane* gateThreshold = nullptr;
+};
+
+// KompCoefficients with a voice filter per lane
+template <typename Lane>
+struct KompLaneCoefficients
+{
+    const GainCurveTable* gainCurve = nullptr;
+    float release = 0.0f;
+    const GainCurveTable* gateCurve = nullptr;
+    Lane peak[5] {};
+    float highPass[5] {};
+};
+
+//==============================================================================
+// The coefficients are floats shared by all the lanes, or one Lane each
+template <typename Lane, typename Coefficient>
+inline Lane processBiquad (Lane input, const Coefficient* c, Lane* state) noexcept
+{
+    const auto output = input * c[0] + state[0];
+    state[0] = input * c[1] - output * c[3] + state[1];
+    state[1] = input * c[2] - output * c[4];
+    return output;
+}
+
+// {b0, b1, b2, a0, a1, a2} -> {b0, b1, b2, a1, a2} / a0
+inline void normaliseBiquad (const std::array<float, 6>& c, float* destination) noexcept
+{
+    const auto a0Inverse = 1.0f / c[3];
+
+    destination[0] = c[0] * a0Inverse;
+    destination[1] = c[1] * a0Inverse;
+    destination[2] = c[2] * a0Inverse;
+    destination[3] = c[4] * a0Inverse;
+    destination[4] = c[5] * a0Inverse;
+}
+
+// Same numerator and denominator, e.g. a peak filter with no gain (the middle voice)
+inline bool isIdentityBiquad (const std::array<float, 6>& c) noexcept
+{
+    return juce::exactlyEqual (c[0], c[3]) && juce::exactlyEqual (c[1], c[4]) && juce::exactlyEqual (c[2], c[5]);
+}
+
+// The same for a normalised one, {b0, b1, b2, a1, a2}
+inline bool isIdentityBiquad (const float* c) noexcept
+{
+    return juce::exactlyEqual (c[0], 1.0f) && juce::exactlyEqual (c[1], c[3]) && juce::exactlyEqual (c[2], c[4]);
+}
+
+//==============================================================================
+enum class KompDetector
+{
+    perLane,    // every lane follows its own envelope
+    linked,     // ramps.linkedGain, computed over all the channels
+    external    // compressed signal computed by the multiband front end
+};
+
+//==============================================================================
+/**
+    The whole PunkKomp chain for one sample of one lane:
+
+    input gain -> compressor (peak ballistics + 4:1 gain curve) -> dry/wet mix
+    -> voice peak filter -> 10 Hz high-pass -> output gain
+
+    With a gateCurve the compressor gain is also multiplied by a downward
+    expander gain read off the same envelope, so the gate costs a table lookup
+    per sample rather than a detector of its own.
+
+    It matches the juce::dsp::Gain, Compressor, DryWetMixer (linear rule) and
+    IIR::Filter stages it replaces, but runs them in a single pass so every
+    lane keeps its envelope and biquad state in registers. The compressor's
+    pow is the exception: it comes from a GainCurveTable, which is within
+    0.000022 dB of it rather than bit identical.
+
+    With the external detector the compressor is skipped and external holds the
+    already compressed samples, so the multiband mode shares the rest of the chain.
+    WithPeak false drops the voice filter, for the flat voice.
+
+    The ramps and the voice filter are shared by all the lanes (KompRamps,
+    KompCoefficients), or per lane (KompLaneRamps, KompLaneCoefficients).
+*/
+template <typename Lane, KompDetector Detector, bool WithPeak = true, typename Coefficients = KompCoefficients, typename Ramps = KompRamps>
+void processKomp (Lane* samples, int numSamples, KompState<Lane>& state, const Coefficients& c, const Ramps& ramps,
+                  const Lane* external = nullptr) noexcept
+{
+    auto s = state;
+
+    const Lane release (c.release);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto dry = samples[i];
+        const auto x = dry * ramps.input[i];
+        const auto level = LaneOps::abs (x);
+
+        Lane compressed;
+
+        if constexpr (Detector == KompDetector::external)
+        {
+            compressed = external[i];
+        }
+        else if constexpr (Detector == KompDetector::linked)
+        {
+            compressed = x * Lane (ramps.linkedGain[i]);
+        }
+        else
+        {
+            s.envelope = level + LaneOps::selectGreater (level, s.envelope, Lane (ramps.attack[i]), release) * (s.envelope - level);
+            auto gain = LaneOps::compressorGain (s.envelope, ramps.thresholdInverse[i], *c.gainCurve);
+
+            if (c.gateCurve != nullptr)
+                gain = gain * LaneOps::expanderGain (s.envelope, ramps.gateThreshold[i], *c.gateCurve);
+
+            compressed = x * gain;
+        }
+
+        s.inputLevel = LaneOps::max (s.inputLevel, level);
+        s.compressedLevel = LaneOps::max (s.compressedLevel, LaneOps::abs (compressed));
+
+        auto mixed = dry * ramps.dry[i] + compressed * ramps.wet[i];
+
+        if constexpr (WithPeak)
+            mixed = processBiquad (mixed, c.peak, s.peak);
+
+        mixed = processBiquad (mixed, c.highPass, s.highPass);
+
+        samples[i] = mixed * ramps.output[i];
+    }
+
+    state = s;
+}
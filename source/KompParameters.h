@@ -0,0 +1,72 @@
+#pragma once
+
+#include "KompEngine.h"
+
+// Parameter defaults, for the plugin's parameter layout and libpunkkomp alike
+#define DEFAULT_OUTPUT 0.0f
+#define DEFAULT_COMP 5.0f
+#define DEFAULT_ATTACK 30.0f
+#define DEFAULT_MIX 80.0f
+#define DEFAULT_VOICE 1
+#define DEFAULT_BANDS 1
+#define DEFAULT_XLOW 200.0f
+#define DEFAULT_XHIGH 3000.0f
+#define DEFAULT_GATE -80.0f
+#define DEFAULT_MORPH 1.0f
+
+//==============================================================================
+/**
+    How the plugin's parameters, in their plain units, drive a KompEngine.
+
+    The processor and libpunkkomp both go through these, so a parameter set
+    sounds exactly the same in either.
+*/
+namespace KompParameters
+{
+    // Not exposed as parameters
+    static constexpr float ratio = 4.0f;
+    static constexpr float releaseMs = 50.0f;
+    static constexpr float gateRatio = 4.0f;
+    static constexpr float limiterCeilingDecibels = -0.3f;    // the LIMIT switch's
+
+    // COMP turns the input up and the threshold down together
+    inline float getInputGainDecibels (float comp) noexcept    { return juce::jmap (comp, 0.0f, 10.0f, -5.0f, 20.0f); }
+    inline float getThresholdDecibels (float comp) noexcept    { return juce::jmap (comp, 0.0f, 10.0f, -5.0f, -25.0f); }
+
+    // GATE is the gate threshold in dB, its lowest position turns the gate off
+    static constexpr float gateOffDecibels = -80.0f;
+
+    inline void setGate (KompEngine& engine, float gate)
+    {
+        engine.setGateEnabled (gate > gateOffDecibels);
+        engine.setGateThreshold (gate);
+    }
+
+    // MIX is in percent
+    inline float getWetProportion (float mix) noexcept         { return mix / 100.0f; }
+
+    /** Which of the band offsets (0 low, 1 mid, 2 high) drives each band of the engine.
+        In 2 band mode the upper band is the high one.
+    */
+    inline int getBandOffsetIndex (int numBands, int band) noexcept
+    {
+        return numBands == 2 && band == 1 ? 2 : band;
+    }
+
+    /** Same mapping as COMP: per step, 2.5 dB more input gain and 2 dB lower threshold. */
+    inline void setBandOffset (KompEngine& engine, int band, float offset)
+    {
+        engine.setBandOffsets (band, offset * 2.5f, offset * -2.0f);
+    }
+
+    /** What prepare has to follow with: the hidden parameters, the voice high pass and morph table. */
+    inline void setFixedParameters (KompEngine& engine, const VoiceCoefficients& voices, const VoiceMorphTable& voiceMorph)
+    {
+        engine.setRatio (ratio);
+        engine.setRelease (releaseMs);
+        engine.setGateRatio (gateRatio);
+        engine.setLimiterCeiling (limiterCeilingDecibels);
+        engine.setHighPassCoefficients (voices.highPass);
+        engine.setVoiceMorphTable (voiceMorph);
+    }
+}
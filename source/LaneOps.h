@@ -0,0 +1,375 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include "GainCurveTable.h"
+
+// KompDispatch runs the Lanes under AVX2 and AVX-512 targets on x86, which the
+// gain curve lookups below have intrinsics for
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define PUNKKOMP_X86_DISPATCH 1
+#else
+ #define PUNKKOMP_X86_DISPATCH 0
+#endif
+
+// Small set of helpers so the DSP kernels can be written once and instantiated
+// for a plain float (one channel), for a SIMDRegister (one channel per lane) and
+// for Lanes, a plain array the compiler vectorises for whatever ISA the calling
+// function is built for (see KompDispatch).
+namespace LaneOps
+{
+   #if JUCE_USE_SIMD
+    using Vector = juce::dsp::SIMDRegister<float>;
+   #else
+    using Vector = float;
+   #endif
+
+    template <typename Lane>
+    constexpr int width = 1;
+
+    //==============================================================================
+    inline float abs (float x) noexcept                { return std::abs (x); }
+    inline float max (float a, float b) noexcept       { return a > b ? a : b; }
+
+    // a > b ? x : y
+    inline float selectGreater (float a, float b, float x, float y) noexcept
+    {
+        return a > b ? x : y;
+    }
+
+    inline float horizontalMax (float x, int /*numLanes*/) noexcept   { return x; }
+
+    inline float getLane (float x, size_t /*lane*/) noexcept              { return x; }
+    inline void setLane (float& x, size_t /*lane*/, float value) noexcept { x = value; }
+
+    // Static gain curve of the compressor for a given envelope level, as juce::dsp::Compressor
+    // but with the pow looked up in a shared table (within its getMaxErrorDecibels)
+    inline float compressorGain (float envelope, float thresholdInverse, const GainCurveTable& curve) noexcept
+    {
+        // envelope < threshold maps to x < 1, which the table clamps to unity gain
+        return curve (envelope * thresholdInverse);
+    }
+
+    // Downward expander below the threshold, from the compressor's table class with x = threshold / envelope.
+    // Past the end of the table the gain stays at its last entry, which is the gate's floor (no pow on silence).
+    inline float expanderGain (float envelope, float threshold, const GainCurveTable& curve) noexcept
+    {
+        return curve.lookup (threshold / envelope);
+    }
+
+    //==============================================================================
+   #if JUCE_USE_SIMD
+    template <>
+    constexpr int width<Vector> = (int) Vector::size();
+
+    inline Vector abs (Vector x) noexcept              { return Vector::abs (x); }
+    inline Vector max (Vector a, Vector b) noexcept    { return Vector::max (a, b); }
+
+    inline Vector selectGreater (Vector a, Vector b, Vector x, Vector y) noexcept
+    {
+        const auto mask = Vector::greaterThan (a, b);
+        return (x & mask) + (y & ~mask);
+    }
+
+    inline float horizontalMax (Vector x, int numLanes) noexcept
+    {
+        auto result = x.get (0);
+
+        for (size_t i = 1; i < (size_t) numLanes; ++i)
+            result = max (result, x.get (i));
+
+        return result;
+    }
+
+    inline float getLane (Vector x, size_t lane) noexcept              { return x.get (lane); }
+    inline void setLane (Vector& x, size_t lane, float value) noexcept { x.set (lane, value); }
+
+   #if JUCE_INTEL
+    // GainCurveTable::lookup on four lanes: the index and fraction are worked out in the
+    // register, only the loads go lane by lane as SSE has no gather
+    inline __m128 lookup (__m128 x, const GainCurveTable& curve) noexcept
+    {
+        x = _mm_min_ps (_mm_max_ps (x, _mm_set1_ps (1.0f)), _mm_set1_ps (GainCurveTable::lastInput));
+
+        const auto offset = _mm_sub_epi32 (_mm_castps_si128 (x), _mm_set1_epi32 ((int) GainCurveTable::oneBits));
+        const auto fraction = _mm_mul_ps (_mm_cvtepi32_ps (_mm_and_si128 (offset, _mm_set1_epi32 ((int) GainCurveTable::fractionMask))),
+                                          _mm_set1_ps (1.0f / (float) (1u << GainCurveTable::fractionBits)));
+
+        alignas (16) int index[4];
+        _mm_store_si128 (reinterpret_cast<__m128i*> (index), _mm_srli_epi32 (offset, (int) GainCurveTable::fractionBits));
+
+        const auto* entries = curve.getEntries();
+        const auto a = _mm_setr_ps (entries[index[0]], entries[index[1]], entries[index[2]], entries[index[3]]);
+        const auto b = _mm_setr_ps (entries[index[0] + 1], entries[index[1] + 1], entries[index[2] + 1], entries[index[3] + 1]);
+
+        return _mm_add_ps (a, _mm_mul_ps (fraction, _mm_sub_ps (b, a)));
+    }
+
+    // The threshold is one for all the lanes, or one per lane. The rare lanes over
+    // the table's range are redone with pow.
+    inline Vector compressorGain (Vector envelope, Vector thresholdInverse, const GainCurveTable& curve) noexcept
+    {
+        const auto x = (envelope * thresholdInverse).value;
+        Vector gain { lookup (x, curve) };
+
+        if (_mm_movemask_ps (_mm_cmpge_ps (x, _mm_set1_ps (GainCurveTable::maxInput))) != 0)
+            for (size_t i = 0; i < Vector::size(); ++i)
+                gain.set (i, curve (Vector { x }.get (i)));
+
+        return gain;
+    }
+
+    inline Vector expanderGain (Vector envelope, Vector threshold, const GainCurveTable& curve) noexcept
+    {
+        return { lookup (_mm_div_ps (threshold.value, envelope.value), curve) };
+    }
+   #else
+    // Without the x86 intrinsics the lanes go through the table one by one
+    inline Vector compressorGain (Vector envelope, Vector thresholdInverse, const GainCurveTable& curve) noexcept
+    {
+        alignas (sizeof (Vector)) float values[Vector::size()];
+        (envelope * thresholdInverse).copyToRawArray (values);
+
+        for (auto& value : values)
+            value = curve (value);
+
+        return Vector::fromRawArray (values);
+    }
+
+    inline Vector expanderGain (Vector envelope, Vector threshold, const GainCurveTable& curve) noexcept
+    {
+        alignas (sizeof (Vector)) float values[Vector::size()], thresholds[Vector::size()];
+        envelope.copyToRawArray (values);
+        threshold.copyToRawArray (thresholds);
+
+        for (size_t i = 0; i < Vector::size(); ++i)
+            values[i] = expanderGain (values[i], thresholds[i], curve);
+
+        return Vector::fromRawArray (values);
+    }
+   #endif
+   #endif
+
+    //==============================================================================
+    // N floats with element-wise operations written as plain loops. They have no
+    // intrinsics of their own, so the same code becomes SSE, AVX2 or AVX-512
+    // depending on the target of the function they are inlined into. Only the
+    // gain curves, which the compiler won't vectorise, have 8 and 16 lane versions.
+    template <size_t N>
+    struct Lanes
+    {
+        static constexpr size_t size() noexcept { return N; }
+
+        Lanes() = default;
+        Lanes (float value) noexcept { for (auto& v : values) v = value; }
+
+        float get (size_t i) const noexcept           { return values[i]; }
+        void set (size_t i, float value) noexcept     { values[i] = value; }
+
+        template <typename Op>
+        friend Lanes apply (Lanes a, Lanes b, Op op) noexcept
+        {
+            for (size_t i = 0; i < N; ++i)
+                a.values[i] = op (a.values[i], b.values[i]);
+
+            return a;
+        }
+
+        friend Lanes operator+ (Lanes a, Lanes b) noexcept { return apply (a, b, std::plus<>()); }
+        friend Lanes operator- (Lanes a, Lanes b) noexcept { return apply (a, b, std::minus<>()); }
+        friend Lanes operator* (Lanes a, Lanes b) noexcept { return apply (a, b, std::multiplies<>()); }
+
+        float values[N] {};
+    };
+
+    template <size_t N>
+    constexpr int width<Lanes<N>> = (int) N;
+
+    template <size_t N>
+    inline Lanes<N> abs (Lanes<N> x) noexcept                 { return apply (x, x, [] (float v, float) { return std::abs (v); }); }
+
+    template <size_t N>
+    inline Lanes<N> max (Lanes<N> a, Lanes<N> b) noexcept     { return apply (a, b, [] (float x, float y) { return max (x, y); }); }
+
+    template <size_t N>
+    inline Lanes<N> selectGreater (Lanes<N> a, Lanes<N> b, Lanes<N> x, Lanes<N> y) noexcept
+    {
+        for (size_t i = 0; i < N; ++i)
+            x.values[i] = selectGreater (a.values[i], b.values[i], x.values[i], y.values[i]);
+
+        return x;
+    }
+
+    template <size_t N>
+    inline float horizontalMax (Lanes<N> x, int numLanes) noexcept
+    {
+        auto result = x.values[0];
+
+        for (size_t i = 1; i < (size_t) numLanes; ++i)
+            result = max (result, x.values[i]);
+
+        return result;
+    }
+
+    template <size_t N>
+    inline float getLane (const Lanes<N>& x, size_t lane) noexcept        { return x.values[lane]; }
+
+    template <size_t N>
+    inline void setLane (Lanes<N>& x, size_t lane, float value) noexcept  { x.values[lane] = value; }
+
+    // Generic form, one lane after the other: the compiler doesn't vectorise the lookup's
+    // table loads, so the widths KompDispatch runs have their own gather versions below.
+    // The rare lanes over the table's range are redone with pow afterwards.
+    template <size_t N>
+    inline Lanes<N> compressorGain (Lanes<N> envelope, std::type_identity_t<Lanes<N>> thresholdInverse, const GainCurveTable& curve) noexcept
+    {
+        const auto x = envelope * thresholdInverse;
+        Lanes<N> gain;
+        auto overflow = false;
+
+        for (size_t i = 0; i < N; ++i)
+        {
+            overflow |= x.values[i] >= GainCurveTable::maxInput;
+            gain.values[i] = curve.lookup (x.values[i]);
+        }
+
+        if (overflow)
+            for (size_t i = 0; i < N; ++i)
+                gain.values[i] = curve (x.values[i]);
+
+        return gain;
+    }
+
+    template <size_t N>
+    inline Lanes<N> expanderGain (Lanes<N> envelope, std::type_identity_t<Lanes<N>> threshold, const GainCurveTable& curve) noexcept
+    {
+        for (size_t i = 0; i < N; ++i)
+            envelope.values[i] = expanderGain (envelope.values[i], threshold.values[i], curve);
+
+        return envelope;
+    }
+
+   #if PUNKKOMP_X86_DISPATCH
+    // GainCurveTable::lookup on eight lanes, with the index and fraction worked out
+    // lane-wise and both entries fetched with a gather
+    __attribute__ ((target ("avx2")))
+    inline __m256 lookup (__m256 x, const GainCurveTable& curve) noexcept
+    {
+        x = _mm256_min_ps (_mm256_max_ps (x, _mm256_set1_ps (1.0f)), _mm256_set1_ps (GainCurveTable::lastInput));
+
+        const auto offset = _mm256_sub_epi32 (_mm256_castps_si256 (x), _mm256_set1_epi32 ((int) GainCurveTable::oneBits));
+        const auto index = _mm256_srli_epi32 (offset, (int) GainCurveTable::fractionBits);
+        const auto fraction = _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_and_si256 (offset, _mm256_set1_epi32 ((int) GainCurveTable::fractionMask))),
+                                             _mm256_set1_ps (1.0f / (float) (1u << GainCurveTable::fractionBits)));
+
+        const auto a = _mm256_i32gather_ps (curve.getEntries(), index, sizeof (float));
+        const auto b = _mm256_i32gather_ps (curve.getEntries() + 1, index, sizeof (float));
+
+        return _mm256_add_ps (a, _mm256_mul_ps (fraction, _mm256_sub_ps (b, a)));
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline Lanes<8> compressorGain (Lanes<8> envelope, Lanes<8> thresholdInverse, const GainCurveTable& curve) noexcept
+    {
+        const auto x = envelope * thresholdInverse;
+        const auto xs = _mm256_loadu_ps (x.values);
+
+        Lanes<8> gain;
+        _mm256_storeu_ps (gain.values, lookup (xs, curve));
+
+        if (_mm256_movemask_ps (_mm256_cmp_ps (xs, _mm256_set1_ps (GainCurveTable::maxInput), _CMP_GE_OQ)) != 0)
+            for (size_t i = 0; i < 8; ++i)
+                gain.values[i] = curve (x.values[i]);
+
+        return gain;
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline Lanes<8> expanderGain (Lanes<8> envelope, Lanes<8> threshold, const GainCurveTable& curve) noexcept
+    {
+        Lanes<8> gain;
+        _mm256_storeu_ps (gain.values, lookup (_mm256_div_ps (_mm256_loadu_ps (threshold.values), _mm256_loadu_ps (envelope.values)), curve));
+        return gain;
+    }
+
+    // The same on sixteen lanes
+    __attribute__ ((target ("avx512f")))
+    inline __m512 lookup (__m512 x, const GainCurveTable& curve) noexcept
+    {
+        x = _mm512_min_ps (_mm512_max_ps (x, _mm512_set1_ps (1.0f)), _mm512_set1_ps (GainCurveTable::lastInput));
+
+        const auto offset = _mm512_sub_epi32 (_mm512_castps_si512 (x), _mm512_set1_epi32 ((int) GainCurveTable::oneBits));
+        const auto index = _mm512_srli_epi32 (offset, (int) GainCurveTable::fractionBits);
+        const auto fraction = _mm512_mul_ps (_mm512_cvtepi32_ps (_mm512_and_si512 (offset, _mm512_set1_epi32 ((int) GainCurveTable::fractionMask))),
+                                             _mm512_set1_ps (1.0f / (float) (1u << GainCurveTable::fractionBits)));
+
+        const auto a = _mm512_i32gather_ps (index, curve.getEntries(), sizeof (float));
+        const auto b = _mm512_i32gather_ps (index, curve.getEntries() + 1, sizeof (float));
+
+        return _mm512_add_ps (a, _mm512_mul_ps (fraction, _mm512_sub_ps (b, a)));
+    }
+
+    __attribute__ ((target ("avx512f")))
+    inline Lanes<16> compressorGain (Lanes<16> envelope, Lanes<16> thresholdInverse, const GainCurveTable& curve) noexcept
+    {
+        const auto x = envelope * thresholdInverse;
+        const auto xs = _mm512_loadu_ps (x.values);
+
+        Lanes<16> gain;
+        _mm512_storeu_ps (gain.values, lookup (xs, curve));
+
+        if (_mm512_cmp_ps_mask (xs, _mm512_set1_ps (GainCurveTable::maxInput), _CMP_GE_OQ) != 0)
+            for (size_t i = 0; i < 16; ++i)
+                gain.values[i] = curve (x.values[i]);
+
+        return gain;
+    }
+
+    __attribute__ ((target ("avx512f")))
+    inline Lanes<16> expanderGain (Lanes<16> envelope, Lanes<16> threshold, const GainCurveTable& curve) noexcept
+    {
+        Lanes<16> gain;
+        _mm512_storeu_ps (gain.values, lookup (_mm512_div_ps (_mm512_loadu_ps (threshold.values), _mm512_loadu_ps (envelope.values)), curve));
+        return gain;
+    }
+   #endif
+
+    //==============================================================================
+    // Vector with one lane per band of the multiband mode, so it needs at least three lanes
+   #if JUCE_USE_SIMD
+    using BandVector = Vector;
+   #else
+    using BandVector = Lanes<4>;
+   #endif
+
+    static_assert (width<BandVector> >= 3);
+
+    // The lanes past the bands are silent, so only the first three are added, and always in the same
+    // order: SIMDRegister::sum's order follows the register width, and so would the output's rounding
+    inline float horizontalSum (BandVector x) noexcept
+    {
+        return (x.get (0) + x.get (1)) + x.get (2);
+    }
+
+    // Gain curve with a threshold per band, only the first numBands lanes are looked up
+    inline BandVector compressorGain (BandVector envelope, BandVector thresholdInverse, const GainCurveTable& curve, int numBands) noexcept
+    {
+        const auto x = envelope * thresholdInverse;
+        BandVector gain (1.0f);
+
+        for (size_t i = 0; i < (size_t) numBands; ++i)
+            gain.set (i, curve (x.get (i)));
+
+        return gain;
+    }
+
+    inline BandVector expanderGain (BandVector envelope, BandVector threshold, const GainCurveTable& curve, int numBands) noexcept
+    {
+        BandVector gain (1.0f);
+
+        for (size_t i = 0; i < (size_t) numBands; ++i)
+            gain.set (i, expanderGain (envelope.get (i), threshold.get (i), curve));
+
+        return gain;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/**
+    Fixed-size ring buffer of level readings shared between the audio thread
+    and the GUI.
+
+    The audio thread pushes one frame every samplesPerFrame samples and never
+    blocks. Readers keep their own read position; a reader that falls more than
+    a whole buffer behind just skips to the oldest frame still held.
+*/
+class LevelHistory
+{
+public:
+    struct Frame
+    {
+        float inputDb = -100.0f;
+        float reductionDb = 0.0f;
+    };
+
+    static constexpr int samplesPerFrame = 64;
+    static constexpr int capacity = 8192; // ~11 s at 48 kHz
+
+    void push(const Frame& frame) noexcept
+    {
+        const auto pos = writePosition.load(std::memory_order_relaxed);
+        auto& slot = frames[(size_t) (pos % (juce::uint64) capacity)];
+
+        slot.inputDb.store(frame.inputDb, std::memory_order_relaxed);
+        slot.reductionDb.store(frame.reductionDb, std::memory_order_relaxed);
+
+        writePosition.store(pos + 1, std::memory_order_release);
+    }
+
+    /** Copies up to maxFrames frames written after readPosition into dest and
+        advances readPosition. Returns the number of frames copied.
+    */
+    int pull(juce::uint64& readPosition, Frame* dest, int maxFrames) const noexcept
+    {
+        const auto end = writePosition.load(std::memory_order_acquire);
+
+        if (end - readPosition > (juce::uint64) capacity)
+            readPosition = end - (juce::uint64) capacity;
+
+        const auto numFrames = (int) juce::jmin((juce::uint64) maxFrames, end - readPosition);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto& slot = frames[(size_t) ((readPosition + (juce::uint64) i) % (juce::uint64) capacity)];
+            dest[i] = { slot.inputDb.load(std::memory_order_relaxed),
+                        slot.reductionDb.load(std::memory_order_relaxed) };
+        }
+
+        readPosition += (juce::uint64) numFrames;
+        return numFrames;
+    }
+
+    juce::uint64 getWritePosition() const noexcept { return writePosition.load(std::memory_order_acquire); }
+
+private:
+    struct Slot
+    {
+        std::atomic<float> inputDb { -100.0f };
+        std::atomic<float> reductionDb { 0.0f };
+    };
+
+    std::array<Slot, capacity> frames;
+    std::atomic<juce::uint64> writePosition { 0 };
+};
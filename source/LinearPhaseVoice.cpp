@@ -0,0 +1,178 @@
+#include "LinearPhaseVoice.h"
+
+//==============================================================================
+void LinearPhaseVoice::prepare (DspResources& newResources, double newSampleRate, int maxChannels)
+{
+    jassert (newSampleRate > 0 && maxChannels > 0);
+
+    resources = &newResources;
+    sampleRate = newSampleRate;
+    maxPairs = (maxChannels + 1) / 2;
+
+    // The audio thread is stopped, so the buffers can be replaced under it
+    if (isReady())
+        layOut (resources->getVoiceLinearPhaseKernels (sampleRate));
+}
+
+void LinearPhaseVoice::build()
+{
+    jassert (resources != nullptr);    // not prepared
+
+    if (isReady() || resources == nullptr)
+        return;
+
+    layOut (resources->getVoiceLinearPhaseKernels (sampleRate));
+    ready.store (true, std::memory_order_release);
+}
+
+void LinearPhaseVoice::layOut (const VoiceLinearPhaseKernels& newKernels)
+{
+    kernels = &newKernels;
+    kernelLength = kernels->kernelLength;
+    fftSize = kernels->fftSize;
+    hopSize = kernels->hopSize;
+
+    if (fft == nullptr || fft->getSize() != fftSize)
+        fft = std::make_unique<juce::dsp::FFT> (kernels->fftOrder);
+
+    scratch.beginLayout();
+    const auto frameBuffer = scratch.reserve<Complex> ((size_t) (maxPairs * fftSize));
+    const auto hopBuffer = scratch.reserve<Complex> ((size_t) (maxPairs * hopSize));
+    const auto hopFillBuffer = scratch.reserve<int> ((size_t) maxPairs);
+    const auto spectrumBuffer = scratch.reserve<Complex> ((size_t) fftSize);
+    const auto convolvedBuffer = scratch.reserve<Complex> ((size_t) fftSize);
+    scratch.allocate();
+
+    frames = scratch.get<Complex> (frameBuffer);
+    hops = scratch.get<Complex> (hopBuffer);
+    hopFills = scratch.get<int> (hopFillBuffer);
+    spectrum = scratch.get<Complex> (spectrumBuffer);
+    convolved = scratch.get<Complex> (convolvedBuffer);
+
+    clear();
+    latency.store (hopSize + (kernelLength - 1) / 2, std::memory_order_relaxed);
+}
+
+void LinearPhaseVoice::reset() noexcept
+{
+    if (isReady())
+        clear();
+}
+
+void LinearPhaseVoice::clear() noexcept
+{
+    // Silence in the history and in the hop being read out
+    std::fill (frames, frames + maxPairs * fftSize, Complex());
+    std::fill (hops, hops + maxPairs * hopSize, Complex());
+
+    // The first hop of a pair starting part way in is short, the silence before it counts as the rest
+    for (int pair = 0; pair < maxPairs; ++pair)
+        hopFills[pair] = hopSize * pair / maxPairs;
+}
+
+void LinearPhaseVoice::setVoice (int newVoice) noexcept
+{
+    jassert (juce::isPositiveAndBelow (newVoice, VoiceCoefficients::numVoices));
+    voice = newVoice;
+}
+
+//==============================================================================
+void LinearPhaseVoice::processHop (int pair, bool convolve) noexcept
+{
+    const auto history = kernelLength - 1;
+    const auto centre = history / 2;
+    const auto* kernel = kernels->spectra[(size_t) voice].data();
+
+    auto* frame = frames + pair * fftSize;
+    auto* hop = hops + pair * hopSize;
+
+    if (convolve)
+    {
+        fft->perform (frame, spectrum, false);
+
+        // By hand, as std::complex's operator* checks for infinities on every bin
+        for (int k = 0; k < fftSize; ++k)
+        {
+            const auto a = spectrum[k], b = kernel[k];
+            spectrum[k] = { a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() };
+        }
+
+        fft->perform (spectrum, convolved, true);
+
+        // The first kernelLength - 1 samples wrapped round the frame, the rest are the new hop
+        std::copy (convolved + history, convolved + fftSize, hop);
+    }
+    else
+    {
+        // Where the kernel's centre tap alone would put the hop
+        std::copy (frame + history - centre, frame + history - centre + hopSize, hop);
+    }
+
+    std::memmove (frame, frame + hopSize, (size_t) history * sizeof (Complex));
+}
+
+void LinearPhaseVoice::run (const juce::dsp::AudioBlock<float>& block, bool convolve) noexcept
+{
+    const auto numChannels = (int) block.getNumChannels();
+    const auto numSamples = (int) block.getNumSamples();
+    const auto numPairs = juce::jmin (maxPairs, (numChannels + 1) / 2);
+    const auto history = kernelLength - 1;
+
+    jassert ((numChannels + 1) / 2 <= maxPairs);
+
+    for (int pair = 0; pair < numPairs; ++pair)
+    {
+        auto& hopFill = hopFills[pair];
+
+        for (int start = 0; start < numSamples;)
+        {
+            const auto length = juce::jmin (hopSize - hopFill, numSamples - start);
+
+            // In go the new samples, out come the ones of the last hop in their place
+            auto* in = frames + pair * fftSize + history + hopFill;
+            const auto* out = hops + pair * hopSize + hopFill;
+            auto* left = block.getChannelPointer ((size_t) (2 * pair)) + start;
+
+            if (2 * pair + 1 < numChannels)
+            {
+                auto* right = block.getChannelPointer ((size_t) (2 * pair + 1)) + start;
+
+                for (int i = 0; i < length; ++i)
+                {
+                    in[i] = { left[i], right[i] };
+                    left[i] = out[i].real();
+                    right[i] = out[i].imag();
+                }
+            }
+            else
+            {
+                for (int i = 0; i < length; ++i)
+                {
+                    in[i] = { left[i], 0.0f };
+                    left[i] = out[i].real();
+                }
+            }
+
+            start += length;
+            hopFill += length;
+
+            if (hopFill == hopSize)
+            {
+                processHop (pair, convolve);
+                hopFill = 0;
+            }
+        }
+    }
+}
+
+void LinearPhaseVoice::process (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    if (isReady())
+        run (block, true);
+}
+
+void LinearPhaseVoice::processDelayOnly (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    if (isReady())
+        run (block, false);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "DspResources.h"
+#include "ScratchArena.h"
+
+//==============================================================================
+/**
+    The linear phase voice: a FIR kernel (VoiceLinearPhaseKernels) that undoes
+    the voice filter's phase, convolved by FFT overlap-save with the output of
+    the peak biquad, which keeps running. Together they're the voice filter's
+    magnitude in linear phase, and the filter voice is there to crossfade with
+    (see KompEngine).
+
+    Samples go into a frame of fftSize per pair of channels, after the last
+    kernelLength - 1, and every hopSize samples the frame is transformed,
+    multiplied by the kernel's spectrum and transformed back. The hop that
+    comes out is read while the next one goes in, so the output is late by a
+    hop plus the kernel's centre tap (getLatencySamples).
+
+    The two channels of a pair go through one complex FFT, the left as the
+    real part and the right as the imaginary part: the kernel is real, so
+    they come back out on the same sides, for half the transforms of one
+    real FFT per channel.
+
+    Everything happens on the hop, so the cost comes in bursts of a few
+    hundred microseconds rather than a little per block. Each pair's hops are
+    offset by hopSize / pairs from the last pair's, so with 16 channels the
+    eight pairs transform in eight different blocks instead of one. The
+    offset only moves the hops, not the delay.
+
+    The FFT and the buffers (120 kB for a stereo pair at 48 kHz) are only
+    made by build, so instances that never use them don't pay for them.
+    build runs off the audio thread, while process may be running, and
+    publishes them with an atomic flag.
+*/
+class LinearPhaseVoice
+{
+public:
+    /** Keeps the sample rate and the channel count, and builds again for them if build has been
+        called before. Channels past maxChannels in a block are left as they are.
+    */
+    void prepare (DspResources& resources, double sampleRate, int maxChannels);
+    void reset() noexcept;
+
+    /** Looks the kernels up and lays out everything for them, unless it's done already. It allocates
+        and locks, so call it from the message thread or an offline render; the audio thread can keep
+        processing meanwhile.
+    */
+    void build();
+    bool isReady() const noexcept                       { return ready.load (std::memory_order_acquire); }
+
+    /** Takes over at the next hop. Like the voice switch, there's no crossfade. */
+    void setVoice (int newVoice) noexcept;
+
+    /** The delay of the hop and the kernel's centre, in samples, once it's built, and 0 before.
+        Any thread can ask, build publishes it along with the buffers.
+    */
+    int getLatencySamples() const noexcept              { return isReady() ? latency.load (std::memory_order_relaxed) : 0; }
+
+    size_t getScratchBytes() const noexcept             { return scratch.getNumBytes(); }
+
+    /** This and processDelayOnly do nothing until isReady. */
+    void process (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    /** Only the delay, for a bypassed chain that has to keep the same latency. */
+    void processDelayOnly (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+    using Complex = juce::dsp::Complex<float>;
+
+    void layOut (const VoiceLinearPhaseKernels& newKernels);
+    void clear() noexcept;
+    void run (const juce::dsp::AudioBlock<float>& block, bool convolve) noexcept;
+    void processHop (int pair, bool convolve) noexcept;
+
+    DspResources* resources = nullptr;
+    double sampleRate = 0.0;
+
+    const VoiceLinearPhaseKernels* kernels = nullptr;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int kernelLength = 1, fftSize = 0, hopSize = 0, maxPairs = 0;
+    int voice = 1;
+
+    // Per pair, the frame (the history, then the hop being filled), the hop being read out and how far in it is
+    Complex* frames = nullptr;
+    Complex* hops = nullptr;
+    int* hopFills = nullptr;
+
+    // The FFT's output and the inverse's, shared by the pairs
+    Complex* spectrum = nullptr;
+    Complex* convolved = nullptr;
+
+    ScratchArena scratch;
+    std::atomic<int> latency { 0 };
+    std::atomic<bool> ready { false };
+};
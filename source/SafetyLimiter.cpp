@@ -0,0 +1,200 @@
+#include "SafetyLimiter.h"
+
+//==============================================================================
+void SafetyLimiter::prepare (double sampleRate, int maxChannels, int maxBlockSize)
+{
+    jassert (sampleRate > 0 && maxChannels > 0 && maxBlockSize > 0);
+
+    lookahead = juce::jmax (1, juce::roundToInt (lookaheadSeconds * sampleRate));
+    release = static_cast<float> (std::exp (-1.0 / (releaseSeconds * sampleRate)));
+    wedgeCapacity = lookahead + 1;
+    averageScale = 1.0 / (double) lookahead;
+
+    // Room for a few lookaheads past the history, so the lines only move back now and then
+    const auto lineLength = (size_t) (lookahead + juce::jmax (maxBlockSize, 4 * lookahead));
+
+    scratch.beginLayout();
+    const auto wedgeGainBuffer = scratch.reserve<float> ((size_t) wedgeCapacity);
+    const auto wedgeSampleBuffer = scratch.reserve<juce::int64> ((size_t) wedgeCapacity);
+    const auto averageBuffer = scratch.reserve<float> ((size_t) lookahead);
+    const auto lineBlock = scratch.reserveBlock ((size_t) maxChannels, lineLength);
+    const auto gainLineBuffer = scratch.reserve<float> (lineLength);
+    const auto gainBuffer = scratch.reserve<float> ((size_t) maxBlockSize);
+    scratch.allocate();
+
+    wedgeGains = scratch.get<float> (wedgeGainBuffer);
+    wedgeSamples = scratch.get<juce::int64> (wedgeSampleBuffer);
+    averageRing = scratch.get<float> (averageBuffer);
+    lines = scratch.get (lineBlock);
+    gainLine = scratch.get<float> (gainLineBuffer);
+    gains = scratch.get<float> (gainBuffer);
+
+    reset();
+}
+
+void SafetyLimiter::reset()
+{
+    resetDetector();
+
+    // Silence in the delay lines
+    lines.clear();
+    std::fill (gainLine, gainLine + lookahead, 0.0f);
+    lineStart = 0;
+}
+
+void SafetyLimiter::resetDetector() noexcept
+{
+    wedgeFront = wedgeSize = 0;
+    sampleCount = 0;
+    released = 1.0f;
+    detectorIsIdle = false;
+
+    // Unity gain all along the lookahead
+    std::fill (averageRing, averageRing + lookahead, 1.0f);
+    averagePosition = 0;
+    averageSum = (double) lookahead;
+}
+
+void SafetyLimiter::setCeiling (float newCeilingDecibels) noexcept
+{
+    ceiling = juce::Decibels::decibelsToGain (newCeilingDecibels);
+}
+
+//==============================================================================
+float SafetyLimiter::computeGain (float level) noexcept
+{
+    const auto target = level > ceiling ? ceiling / level : 1.0f;
+
+    // Running minimum: the front leaves once it's older than the window, and a new gain removes
+    // every queued one that isn't lower, as none of them can be the minimum again
+    if (wedgeSize > 0 && wedgeSamples[wedgeFront] <= sampleCount - wedgeCapacity)
+    {
+        wedgeFront = wrap (wedgeFront + 1);
+        --wedgeSize;
+    }
+
+    auto back = wrap (wedgeFront + wedgeSize);    // one past the newest
+
+    while (wedgeSize > 0)
+    {
+        const auto newest = back > 0 ? back - 1 : wedgeCapacity - 1;
+
+        if (wedgeGains[newest] < target)
+            break;
+
+        back = newest;
+        --wedgeSize;
+    }
+
+    wedgeGains[back] = target;
+    wedgeSamples[back] = sampleCount;
+    ++wedgeSize;
+    ++sampleCount;
+
+    // Down at once, back up over the release. Never above the minimum, so the average that
+    // follows still reaches every peak's gain in time.
+    const auto minimum = wedgeGains[wedgeFront];
+    released = minimum < released ? minimum : minimum + release * (released - minimum);
+
+    averageSum += (double) released - (double) averageRing[averagePosition];
+    averageRing[averagePosition] = released;
+
+    return getAverage();
+}
+
+float SafetyLimiter::getAverage() noexcept
+{
+    // The sum is worked out again once per lap of the ring, so rounding can't build up
+    if (++averagePosition == lookahead)
+    {
+        averagePosition = 0;
+        averageSum = 0.0;
+
+        for (int i = 0; i < lookahead; ++i)
+            averageSum += (double) averageRing[i];
+    }
+
+    return static_cast<float> (averageSum * averageScale);
+}
+
+//==============================================================================
+void SafetyLimiter::makeRoom (int numSamples) noexcept
+{
+    if (lineStart + lookahead + numSamples <= (int) lines.getNumSamples())
+        return;
+
+    const auto move = [this] (float* line) { std::memmove (line, line + lineStart, (size_t) lookahead * sizeof (float)); };
+
+    for (size_t ch = 0; ch < lines.getNumChannels(); ++ch)
+        move (lines.getChannelPointer (ch));
+
+    move (gainLine);
+    lineStart = 0;
+}
+
+float* SafetyLimiter::delay (float* line, const float* input, int numSamples) noexcept
+{
+    juce::FloatVectorOperations::copy (line + lineStart + lookahead, input, numSamples);
+    return line + lineStart;
+}
+
+void SafetyLimiter::process (const juce::dsp::AudioBlock<float>& block, const float* gain) noexcept
+{
+    const auto numChannels = (int) block.getNumChannels();
+    const auto numSamples = (int) block.getNumSamples();
+
+    jassert (numChannels <= (int) lines.getNumChannels());
+    jassert (numSamples + lookahead <= (int) lines.getNumSamples());
+
+    makeRoom (numSamples);
+
+    if (detectorIsIdle)
+        resetDetector();
+
+    // The loudest channel at the output's scale, one value per sample
+    juce::FloatVectorOperations::abs (gains, block.getChannelPointer (0), numSamples);
+
+    for (int ch = 1; ch < numChannels; ++ch)
+    {
+        const auto* samples = block.getChannelPointer ((size_t) ch);
+
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] = juce::jmax (gains[i], std::abs (samples[i]));
+    }
+
+    juce::FloatVectorOperations::multiply (gains, gain, numSamples);
+
+    // One gain per sample for the audio coming out of the delay: the limiter's times the delayed output gain
+    const auto* delayedGain = delay (gainLine, gain, numSamples);
+
+    for (int i = 0; i < numSamples; ++i)
+        gains[i] = computeGain (gains[i]) * delayedGain[i];
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* samples = block.getChannelPointer ((size_t) ch);
+        juce::FloatVectorOperations::multiply (samples, delay (lines.getChannelPointer ((size_t) ch), samples, numSamples), gains, numSamples);
+    }
+
+    lineStart += numSamples;
+}
+
+void SafetyLimiter::processDelayOnly (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+
+    jassert (numSamples + lookahead <= (int) lines.getNumSamples());
+
+    makeRoom (numSamples);
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        auto* samples = block.getChannelPointer (ch);
+        juce::FloatVectorOperations::copy (samples, delay (lines.getChannelPointer (ch), samples, numSamples), numSamples);
+    }
+
+    // Bypassed samples leave at unity gain, should the limiter come back while they're in the line
+    juce::FloatVectorOperations::fill (gainLine + lineStart + lookahead, 1.0f, numSamples);
+    detectorIsIdle = true;
+    lineStart += numSamples;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ScratchArena.h"
+
+//==============================================================================
+/**
+    Brickwall peak limiter with a short lookahead, for the very end of the chain.
+
+    The audio is delayed by the lookahead while the gain needed by every sample
+    (ceiling / peak over all the channels) goes through a running minimum as
+    long as the lookahead, a release, and a moving average as long as the
+    lookahead again. By the time a peak comes out of the delay line the average
+    has come down to its gain, so no sample leaves over the ceiling (give or
+    take the float rounding of the gain), and the gain gets there along a ramp
+    instead of a step.
+
+    The running minimum is a monotonic wedge (Lemire's algorithm), amortised
+    O(1) per sample whatever the lookahead, and the average is a running sum.
+    The channels are linked, so the stereo image stays where it is.
+
+    process takes the output gain ramp of the stage before it and applies it
+    together with the limiter's gain, so a stage that leaves its own gain to the
+    limiter costs nothing extra per channel sample.
+
+    It only runs while it's wanted, so its latency is only there then. Whoever
+    switches it fills the delay and crossfades, the way KompEngine does. After
+    processDelayOnly the detector starts again from unity gain, and has caught
+    up a lookahead later.
+*/
+class SafetyLimiter
+{
+public:
+    static constexpr double lookaheadSeconds = 0.002;
+    static constexpr double releaseSeconds = 0.1;
+
+    /** Lays out everything for up to maxChannels channels of maxBlockSize samples, and resets. */
+    void prepare (double sampleRate, int maxChannels, int maxBlockSize);
+    void reset();
+
+    void setCeiling (float newCeilingDecibels) noexcept;
+
+    /** The delay the lookahead adds, in samples. */
+    int getLatencySamples() const noexcept                  { return lookahead; }
+
+    size_t getScratchBytes() const noexcept                 { return scratch.getNumBytes(); }
+
+    /** Delays the block in place and multiplies it by gain (one value per sample, delayed along
+        with the audio) and the limiter's own gain.
+    */
+    void process (const juce::dsp::AudioBlock<float>& block, const float* gain) noexcept;
+
+    /** Only the delay, for a bypassed chain that has to keep the same latency. */
+    void processDelayOnly (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+    // A line holds the lookahead's history from lineStart, and the next block goes in after it.
+    // delay writes the block and returns where the delayed samples start.
+    void makeRoom (int numSamples) noexcept;
+    float* delay (float* line, const float* input, int numSamples) noexcept;
+
+    void resetDetector() noexcept;
+    int wrap (int index) const noexcept                     { return index < wedgeCapacity ? index : index - wedgeCapacity; }
+    float computeGain (float level) noexcept;
+    float getAverage() noexcept;
+
+    int lookahead = 0;
+    float ceiling = 1.0f;
+    float release = 0.0f;
+
+    // Running minimum of the last lookahead + 1 gains, in a ring of that many (gain, sample) pairs
+    float* wedgeGains = nullptr;
+    juce::int64* wedgeSamples = nullptr;
+    int wedgeCapacity = 0, wedgeFront = 0, wedgeSize = 0;
+    juce::int64 sampleCount = 0;
+
+    float released = 1.0f;
+    bool detectorIsIdle = false;    // it missed samples, and starts again on the next process call
+
+    // The last lookahead released gains and their sum
+    float* averageRing = nullptr;
+    int averagePosition = 0;
+    double averageSum = 0.0, averageScale = 1.0;
+
+    // Delay lines per channel and for the gain, all at the same position
+    juce::dsp::AudioBlock<float> lines;
+    float* gainLine = nullptr;
+    int lineStart = 0;
+    float* gains = nullptr;
+
+    ScratchArena scratch;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ImageResources.h"
+
+namespace juce::Gui
+{
+    // Keeps a copy of an image resampled to the physical pixel size it is drawn at.
+    // The resampling only happens again when that size changes (editor resized or
+    // moved to a screen with a different scale factor), every other frame is a plain blit.
+    // Copies come from ImageResources, so editors of the same size share them.
+    class ScaledImage
+    {
+    public:
+        ScaledImage() = default;
+        explicit ScaledImage(juce::Image sourceImage) : source(std::move(sourceImage)) {}
+
+        void setSource(juce::Image sourceImage)
+        {
+            source = std::move(sourceImage);
+            scaled = {};
+        }
+
+        void setSource(const void* data, int dataSize)
+        {
+            setSource(resources->getImage(data, dataSize));
+        }
+
+        const juce::Image& getSource() const { return source; }
+
+        void draw(juce::Graphics& g, juce::Rectangle<float> area)
+        {
+            const auto pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+            const auto& image = get(area, pixelScale);
+
+            if (image.isValid())
+                g.drawImageTransformed(image, juce::AffineTransform::scale(1.0f / pixelScale).translated(area.getX(), area.getY()));
+        }
+
+        const juce::Image& get(juce::Rectangle<float> area, float pixelScale)
+        {
+            const auto width = juce::jmax(1, juce::roundToInt(area.getWidth() * pixelScale));
+            const auto height = juce::jmax(1, juce::roundToInt(area.getHeight() * pixelScale));
+
+            if (source.isValid() && (scaled.getWidth() != width || scaled.getHeight() != height))
+            {
+                scaled = {};
+                scaled = resources->getScaled(source, width, height);
+            }
+
+            return scaled;
+        }
+
+    private:
+        juce::SharedResourcePointer<ImageResources> resources;
+        juce::Image source;
+        juce::Image scaled;
+    };
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <vector>
+
+//==============================================================================
+/**
+    All of an engine's temporary buffers in one contiguous, cache line aligned
+    allocation.
+
+    prepare lays the buffers out with reserve and reserveBlock, then calls
+    allocate once, which only goes back to the heap when the layout has grown.
+    Every buffer starts on its own cache line, so neighbouring buffers never
+    share one, and the channel pointers of the blocks live in the arena too.
+    Nothing allocates after allocate: the pointers and blocks it hands out
+    stay valid until the next layout.
+*/
+class ScratchArena
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    struct Buffer
+    {
+        size_t offset = 0;
+    };
+
+    struct Block
+    {
+        size_t index = 0;
+    };
+
+    /** Forgets the previous layout. The memory is kept for the next allocate to reuse. */
+    void beginLayout()
+    {
+        layoutBytes = 0;
+        blocks.clear();
+    }
+
+    template <typename Type>
+    Buffer reserve (size_t count)
+    {
+        static_assert (alignof (Type) <= alignment);
+        static_assert (std::is_trivially_copyable_v<Type>);
+
+        const Buffer buffer { layoutBytes };
+        layoutBytes += roundUp (count * sizeof (Type));
+        return buffer;
+    }
+
+    /** Channels of numSamples floats one after the other, each on its own cache lines. */
+    Block reserveBlock (size_t numChannels, size_t numSamples)
+    {
+        const auto pointers = reserve<float*> (numChannels);
+        const auto samples = reserve<float> (numChannels * roundUp (numSamples * sizeof (float)) / sizeof (float));
+
+        blocks.push_back ({ pointers, samples, numChannels, numSamples });
+        return { blocks.size() - 1 };
+    }
+
+    /** Makes room for the layout and zeroes it. */
+    void allocate()
+    {
+        if (layoutBytes > capacity)
+        {
+            storage.allocate (layoutBytes + alignment - 1, false);
+            capacity = layoutBytes;
+        }
+
+        auto address = reinterpret_cast<uintptr_t> (storage.get());
+        data = storage.get() + (roundUp (address) - address);
+        std::fill (data, data + layoutBytes, char());
+
+        for (const auto& block : blocks)
+        {
+            auto* pointers = get<float*> (block.pointers);
+            const auto stride = roundUp (block.numSamples * sizeof (float)) / sizeof (float);
+
+            for (size_t ch = 0; ch < block.numChannels; ++ch)
+                pointers[ch] = get<float> (block.samples) + ch * stride;
+        }
+    }
+
+    template <typename Type>
+    Type* get (Buffer buffer) const noexcept
+    {
+        jassert (data != nullptr && buffer.offset < layoutBytes);
+        return reinterpret_cast<Type*> (data + buffer.offset);
+    }
+
+    juce::dsp::AudioBlock<float> get (Block block) const noexcept
+    {
+        const auto& layout = blocks[block.index];
+        return { get<float*> (layout.pointers), layout.numChannels, layout.numSamples };
+    }
+
+    /** Bytes in use by the current layout, padding included. */
+    size_t getNumBytes() const noexcept     { return layoutBytes; }
+
+private:
+    struct BlockLayout
+    {
+        Buffer pointers, samples;
+        size_t numChannels, numSamples;
+    };
+
+    static size_t roundUp (size_t bytes) noexcept     { return (bytes + alignment - 1) & ~(alignment - 1); }
+
+    juce::HeapBlock<char> storage;
+    char* data = nullptr;
+    size_t capacity = 0, layoutBytes = 0;
+    std::vector<BlockLayout> blocks;
+};